@@ -0,0 +1,18 @@
+#pragma once
+
+#include "CorePCH.h"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <new>
+#include <sstream>
+
+using namespace std::literals;
+
+// The engine logs through logger::info, the benchmarks drop those messages
+namespace logger
+{
+    template <typename... Args>
+    void info(Args&&...) {}
+}
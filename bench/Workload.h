@@ -0,0 +1,95 @@
+#pragma once
+
+namespace slaBench
+{
+    // Stand-in for RE::Actor, the engine only ever needs the form id
+    struct FakeActor
+    {
+        uint32_t formID;
+    };
+
+    // Static effects a typical SexLab Aroused setup registers
+    const char* const kStaticEffectNames[] = {
+        "Naked", "SpectatingSex", "ParticipatingSex", "Orgasm", "TimeRate", "Exposure",
+        "Frustration", "Libido", "Desire", "Attraction", "Lewd", "Devious",
+        "Pheromones", "Drunk", "Aphrodisiac", "Chastity"
+    };
+
+    const uint32_t kDynamicEffectNames = 32;
+    const uint32_t kFirstFormId = 0x00100000;
+
+    // Share of actors without any effect that changes over time
+    const float kIdleShare = 0.5f;
+
+    void RegisterStaticEffects()
+    {
+        for (const char* name : kStaticEffectNames)
+            slaModules::staticEffectRegistry.Register(name);
+    }
+
+    // Creates count actors with a fixed mix of decaying, linear, periodic and step effects,
+    // groups and named dynamic effects. The same seed gives the same population.
+    std::vector<FakeActor> CreateActors(uint32_t count, float time, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        auto range = [&](float low, float high) { return low + (high - low) * unit(rng); };
+        const auto staticCount = static_cast<int32_t>(std::size(kStaticEffectNames));
+
+        std::vector<FakeActor> actors;
+        actors.reserve(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const FakeActor actor{ kFirstFormId + i };
+            actors.push_back(actor);
+            auto data = slaModules::GetArousalData(actor.formID);
+            data->UpdateSingleActorArousal(actor.formID, time);
+
+            // Idle actors only carry values that no longer change
+            if (unit(rng) < kIdleShare)
+            {
+                data->SetStaticArousalValue(0, range(0.f, 20.f));
+                continue;
+            }
+
+            // Decaying exposure and a couple of other decays
+            data->SetStaticArousalValue(5, range(10.f, 80.f));
+            data->SetStaticArousalEffect(5, 1, range(1.f, 4.f), 0.f, 0);
+            const int32_t decay = 6 + static_cast<int32_t>(rng() % 6);
+            data->SetStaticArousalValue(decay, range(5.f, 40.f));
+            data->SetStaticArousalEffect(decay, 1, range(0.5f, 6.f), 0.f, 0);
+
+            // Time rate grows linearly towards its cap
+            data->SetStaticArousalValue(4, range(0.f, 10.f));
+            data->SetStaticArousalEffect(4, 2, range(0.5f, 5.f), range(30.f, 100.f), 0);
+
+            // Periodic libido, grouped with desire for a tenth of the actors
+            if (unit(rng) < 0.3f)
+            {
+                data->SetStaticArousalEffect(7, 3, range(0.5f, 3.f), range(5.f, 15.f), 0);
+                if (unit(rng) < 0.33f)
+                {
+                    data->SetStaticArousalValue(8, range(0.5f, 1.5f));
+                    data->SetStaticArousalEffect(8, 2, 0.1f, 2.f, 0);
+                    data->GroupEffects(actor.formID, 7, 8);
+                }
+            }
+
+            // Occasional step effect
+            if (unit(rng) < 0.1f)
+                data->SetStaticArousalEffect(staticCount - 1, 4, time + range(0.f, 2.f), 20.f, 0);
+
+            // Up to three named dynamic effects out of a shared pool
+            const uint32_t dynamicCount = rng() % 4;
+            for (uint32_t j = 0; j < dynamicCount; ++j)
+            {
+                const std::string name = "Dynamic" + std::to_string(rng() % kDynamicEffectNames);
+                if (unit(rng) < 0.5f)
+                    data->SetDynamicArousalEffect(name, range(5.f, 30.f), 1, range(0.5f, 3.f), 0.f);
+                else
+                    data->SetDynamicArousalEffect(name, range(-10.f, 10.f), 2, range(-3.f, 3.f), range(-20.f, 20.f));
+            }
+        }
+        return actors;
+    }
+}
@@ -0,0 +1,621 @@
+#include "Engine.h"
+#include "MemorySerialization.h"
+#include "NativeStats.h"
+#include "UpdateScheduler.h"
+#include "Workload.h"
+
+// Counts live heap bytes, so memory per actor does not depend on the allocator or the OS
+namespace slaBench
+{
+    std::atomic<int64_t> liveBytes{ 0 };
+    const size_t kAllocationHeader = 16;
+
+    void* Allocate(size_t size)
+    {
+        char* block = static_cast<char*>(std::malloc(size + kAllocationHeader));
+        if (!block)
+            throw std::bad_alloc();
+        std::memcpy(block, &size, sizeof(size));
+        liveBytes += static_cast<int64_t>(size);
+        return block + kAllocationHeader;
+    }
+
+    void Free(void* ptr)
+    {
+        if (!ptr)
+            return;
+        char* block = static_cast<char*>(ptr) - kAllocationHeader;
+        size_t size;
+        std::memcpy(&size, block, sizeof(size));
+        liveBytes -= static_cast<int64_t>(size);
+        std::free(block);
+    }
+}
+
+void* operator new(size_t size) { return slaBench::Allocate(size); }
+void* operator new[](size_t size) { return slaBench::Allocate(size); }
+void operator delete(void* ptr) noexcept { slaBench::Free(ptr); }
+void operator delete[](void* ptr) noexcept { slaBench::Free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { slaBench::Free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { slaBench::Free(ptr); }
+
+namespace slaBench
+{
+    using Clock = std::chrono::steady_clock;
+
+    const float kStartTime = 100.f;
+    const float kTickDays = 0.01f;
+    const uint32_t kSeed = 1234;
+    const uint32_t kMaxStressThreads = 8;
+    const uint32_t kSlices = 200;
+    const auto kSliceBudget = std::chrono::microseconds(500);
+
+    float gameTime = kStartTime;
+
+    float GetGameTime()
+    {
+        return gameTime;
+    }
+
+    double SecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    struct Result
+    {
+        std::string name;
+        uint32_t actors;
+        double value;
+        std::string unit;
+    };
+
+    std::vector<Result> results;
+
+    void Report(std::string name, uint32_t actors, double value, std::string unit)
+    {
+        std::printf("%-22s %8u %16.3f %s\n", name.c_str(), actors, value, unit.c_str());
+        results.push_back({ std::move(name), actors, value, std::move(unit) });
+    }
+
+    std::vector<FakeActor> Populate(uint32_t count, bool lazy)
+    {
+        slaModules::SetLazyUpdateMode(false);
+        slaModules::RevertData();
+        gameTime = kStartTime;
+        RegisterStaticEffects();
+        auto actors = CreateActors(count, gameTime, kSeed);
+        slaModules::SetLazyUpdateMode(lazy);
+        return actors;
+    }
+
+    // Runs ticks sweeps of UpdateAllActors and returns the average time per sweep in seconds
+    double MeasureSweeps(uint32_t ticks)
+    {
+        const auto start = Clock::now();
+        for (uint32_t i = 0; i < ticks; ++i)
+        {
+            gameTime += kTickDays;
+            slaModules::UpdateAllActors(gameTime);
+        }
+        return SecondsSince(start) / ticks;
+    }
+
+    // Eager sweeps on every thread count from 1 to the hardware's, with the speedup over a single
+    // thread. The thread count given on the command line is restored afterwards.
+    void RunThreadScaling(uint32_t count, uint32_t ticks)
+    {
+        auto& pool = slaModules::UpdatePool::GetSingleton();
+        const uint32_t configured = pool.GetThreadCount();
+        const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+        double single = 0.0;
+        for (uint32_t threadCount = 1; threadCount <= maxThreads; ++threadCount)
+        {
+            pool.SetThreadCount(threadCount);
+            // Starts the workers outside of the measurement
+            MeasureSweeps(1);
+            const double seconds = MeasureSweeps(ticks);
+            if (threadCount == 1)
+                single = seconds;
+            const std::string name = "sweep.t" + std::to_string(threadCount);
+            Report(name, count, seconds * 1e6, "us/sweep");
+            Report(name + ".speedup", count, single / seconds, "x");
+        }
+        pool.SetThreadCount(configured);
+    }
+
+    // Chunks not run exactly once while the pool is resized between jobs, workers restarted by a
+    // resize must wait for the next job
+    uint32_t CountPoolResizeMismatches()
+    {
+        auto& pool = slaModules::UpdatePool::GetSingleton();
+        const uint32_t configured = pool.GetThreadCount();
+        std::vector<std::atomic<uint32_t>> runs(64);
+        uint32_t mismatches = 0;
+        for (uint32_t i = 0; i < 200; ++i)
+        {
+            pool.SetThreadCount(2 + i % 6);
+            for (auto& run : runs)
+                run.store(0, std::memory_order_relaxed);
+            pool.ParallelFor(runs.size(), 1, [&runs](size_t begin, size_t end) {
+                for (size_t chunk = begin; chunk < end; ++chunk)
+                    runs[chunk].fetch_add(1, std::memory_order_relaxed);
+            });
+            for (auto const& run : runs)
+                mismatches += run.load(std::memory_order_relaxed) != 1;
+        }
+        pool.SetThreadCount(configured);
+        return mismatches;
+    }
+
+    // Published reads that still see a static effect after it was unregistered, in both update modes
+    uint32_t CountStaleAfterUnregister()
+    {
+        using namespace slaModules;
+        uint32_t stale = 0;
+        for (bool lazy : { false, true })
+        {
+            Populate(0, lazy);
+            const uint32_t formId = kFirstFormId;
+            const int32_t idx = static_cast<int32_t>(staticEffectRegistry.Register("bench.unregistered"));
+            Natives::SetStaticArousalValue(formId, idx, 42.f);
+            Natives::UnregisterStaticEffect("bench.unregistered");
+            float time;
+            const float arousal = GetArousalDataForRead(formId, time)->GetArousalAt(formId, time);
+            stale += Natives::GetArousal(formId) != arousal;
+            stale += Natives::IsStaticEffectActive(formId, idx);
+            stale += Natives::CountActorsAboveArousal(40.f) != 0;
+        }
+        return stale;
+    }
+
+    // Returns millions of reads per second
+    double MeasureSnapshotReads(std::vector<FakeActor> const& actors, uint32_t reads)
+    {
+        std::mt19937 rng(kSeed);
+        float sum = 0.f;
+        const auto start = Clock::now();
+        for (uint32_t i = 0; i < reads; ++i)
+            sum += slaModules::ReadArousal(actors[rng() % actors.size()].formID);
+        const double seconds = SecondsSince(start);
+        if (std::isnan(sum))
+            std::printf("unexpected NaN arousal\n");
+        return reads / seconds / 1e6;
+    }
+
+    const uint32_t kRankedActors = 10;
+
+    // What scripts did before the ranking: every actor from GetActorList, GetArousal on each and a
+    // sort. Returns microseconds per query.
+    double MeasureRankingScan(uint32_t queries)
+    {
+        size_t found = 0;
+        const auto start = Clock::now();
+        for (uint32_t i = 0; i < queries; ++i)
+        {
+            std::vector<uint32_t> formIds;
+            slaModules::arousalData.ForEach([&formIds](uint32_t formId, slaModules::ArousalData&) { formIds.push_back(formId); });
+            std::vector<std::pair<float, uint32_t>> ranked;
+            ranked.reserve(formIds.size());
+            for (uint32_t formId : formIds)
+                ranked.emplace_back(slaModules::ReadArousal(formId), formId);
+            const size_t kept = std::min<size_t>(kRankedActors, ranked.size());
+            std::partial_sort(ranked.begin(), ranked.begin() + kept, ranked.end(), std::greater<>());
+            found += kept;
+        }
+        const double seconds = SecondsSince(start);
+        if (found != size_t(queries) * std::min<size_t>(kRankedActors, slaModules::arousalData.Size()))
+            std::printf("unexpected ranking size\n");
+        return seconds / queries * 1e6;
+    }
+
+    // Returns microseconds per query
+    template <typename F>
+    double MeasureRankingQueries(F query, uint32_t queries)
+    {
+        size_t found = 0;
+        const auto start = Clock::now();
+        for (uint32_t i = 0; i < queries; ++i)
+            found += query(i);
+        const double seconds = SecondsSince(start);
+        if (!found)
+            std::printf("unexpected empty ranking\n");
+        return seconds / queries * 1e6;
+    }
+
+    // Every thread runs ops natives on random actors, mostly reads with some writes that take the
+    // shard locks and intern dynamic effect names, while another thread keeps updating all actors.
+    // Returns millions of natives per second.
+    double MeasureStress(std::vector<FakeActor> const& actors, uint32_t threadCount, uint32_t ops)
+    {
+        std::atomic<uint32_t> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&, t] {
+                std::mt19937 rng(kSeed + t);
+                float sum = 0.f;
+                ready.fetch_add(1);
+                while (!go.load())
+                    std::this_thread::yield();
+                for (uint32_t i = 0; i < ops; ++i)
+                {
+                    const uint32_t formId = actors[rng() % actors.size()].formID;
+                    const uint32_t kind = rng() % 10;
+                    if (kind < 7)
+                        sum += slaModules::ReadArousal(formId);
+                    else if (kind < 9)
+                    {
+                        auto data = slaModules::GetArousalDataForWrite(formId);
+                        sum += data->ModStaticArousalValue(0, 0.1f, 100.f);
+                        data.PublishChanges();
+                    }
+                    else
+                    {
+                        auto data = slaModules::GetArousalDataForWrite(formId);
+                        data->ModDynamicArousalEffect("Dynamic" + std::to_string(rng() % kDynamicEffectNames), 1.f, 50.f);
+                        data.PublishChanges();
+                    }
+                }
+                if (std::isnan(sum))
+                    std::printf("unexpected NaN arousal\n");
+            });
+        }
+        std::atomic<uint32_t> done{ 0 };
+        std::thread updater([&] {
+            while (done.load() != threadCount)
+                slaModules::UpdateAllActors(gameTime);
+        });
+        while (ready.load() != threadCount)
+            std::this_thread::yield();
+        const auto start = Clock::now();
+        go = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+            done.fetch_add(1);
+        }
+        const double seconds = SecondsSince(start);
+        updater.join();
+        return double(ops) * threadCount / seconds / 1e6;
+    }
+
+    // The sine table and std::pow the effect functions used before FastMath, kept to compare against
+    namespace Legacy
+    {
+        const int kTableSize = 512;
+        const float kPi = 3.14159265358979323846f;
+        float sineTable[kTableSize + 1];
+
+        void BuildSineTable()
+        {
+            for (int i = 0; i <= kTableSize; ++i)
+                sineTable[i] = static_cast<float>(std::sin(double(i) * kPi / (kTableSize / 2)));
+        }
+
+        float Sin(float x)
+        {
+            const int i = static_cast<int>(x * (kTableSize / 2) / kPi);
+            if (i < 0)
+                return sineTable[kTableSize - ((-i) & (kTableSize - 1))];
+            return sineTable[i & (kTableSize - 1)];
+        }
+
+        float Exp2(float x)
+        {
+            return std::pow(0.5f, -x);
+        }
+    }
+
+    // Largest error of f against the double precision reference over evenly spaced inputs in [low, high]
+    template <class F, class R>
+    double MaxError(F f, R reference, float low, float high, bool relative)
+    {
+        const uint32_t samples = 1000000;
+        double worst = 0.0;
+        for (uint32_t i = 0; i <= samples; ++i)
+        {
+            const float x = static_cast<float>(low + (double(high) - low) * i / samples);
+            const double expected = reference(double(x));
+            double error = std::fabs(double(f(x)) - expected);
+            if (relative)
+                error /= std::fabs(expected);
+            worst = std::max(worst, error);
+        }
+        return worst;
+    }
+
+    // Returns nanoseconds per call of f over inputs
+    template <class F>
+    double MeasureCalls(F f, std::vector<float> const& inputs)
+    {
+        const uint32_t rounds = 200;
+        float sum = 0.f;
+        const auto start = Clock::now();
+        for (uint32_t round = 0; round < rounds; ++round)
+        {
+            for (float x : inputs)
+                sum += f(x);
+        }
+        const double seconds = SecondsSince(start);
+        if (std::isnan(sum))
+            std::printf("unexpected NaN sum\n");
+        return seconds / rounds / inputs.size() * 1e9;
+    }
+
+    // Values of the vector kernels that differ from the scalar reference on random batches
+    uint32_t CountKernelMismatches()
+    {
+        using namespace slaModules;
+        std::mt19937 rng(kSeed);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        uint32_t mismatches = 0;
+        for (uint32_t round = 0; round < 1000; ++round)
+        {
+            EffectBatch input;
+            input.count = 1 + rng() % kEffectBatchSize;
+            for (uint32_t i = 0; i < input.count; ++i)
+            {
+                input.values[i] = unit(rng) * 100.f;
+                input.params[i] = unit(rng) * 10.f;
+                input.limits[i] = unit(rng) * 50.f;
+                input.functions[i] = kFirstCurveFunction;
+            }
+            input.PadTail();
+            const EffectContext context{ 0.01f + std::fabs(unit(rng)) * 5.f, 100.f + std::fabs(unit(rng)) * 1000.f, std::fabs(unit(rng)) * 79.f };
+            for (uint32_t kind = 0; kind < kEffectKindCount; ++kind)
+            {
+                EffectBatch expected = input;
+                const uint64_t expectedDone = GetEffectKernels(SimdLevel::Scalar).Get(kind)(expected, context);
+                for (auto level : { SimdLevel::SSE2, SimdLevel::AVX2 })
+                {
+                    if (level > GetSupportedSimdLevel())
+                        continue;
+                    EffectBatch actual = input;
+                    if (GetEffectKernels(level).Get(kind)(actual, context) != expectedDone)
+                        ++mismatches;
+                    for (uint32_t i = 0; i < input.count; ++i)
+                        mismatches += std::memcmp(&actual.values[i], &expected.values[i], sizeof(float)) != 0;
+                }
+            }
+        }
+        return mismatches;
+    }
+
+    // Accuracy against libm and cost of the effect math, old against new
+    void RunMath()
+    {
+        Legacy::BuildSineTable();
+        auto sine = [](double x) { return std::sin(x); };
+        auto exp2 = [](double x) { return std::exp2(x); };
+        // Sine effect angles are the phase plus game days times the period parameter
+        Report("math.sin.table.error", 0, MaxError(Legacy::Sin, sine, 0.f, 3000.f, false) * 1e6, "1e-6 abs");
+        Report("math.sin.poly.error", 0, MaxError(slaModules::FastMath::Sin, sine, 0.f, 3000.f, false) * 1e6, "1e-6 abs");
+        Report("math.exp2.pow.error", 0, MaxError(Legacy::Exp2, exp2, -126.f, 127.f, true) * 1e6, "1e-6 rel");
+        Report("math.exp2.poly.error", 0, MaxError(slaModules::FastMath::Exp2, exp2, -126.f, 127.f, true) * 1e6, "1e-6 rel");
+        Report("math.kernel.mismatches", 0, CountKernelMismatches(), "values");
+
+        std::mt19937 rng(kSeed);
+        std::uniform_real_distribution<float> angle(0.f, 3000.f);
+        std::uniform_real_distribution<float> exponent(-20.f, 0.f);
+        std::vector<float> angles(4096);
+        std::vector<float> exponents(4096);
+        for (float& x : angles)
+            x = angle(rng);
+        for (float& x : exponents)
+            x = exponent(rng);
+        Report("math.sin.table", 0, MeasureCalls([](float x) { return Legacy::Sin(x); }, angles), "ns/call");
+        Report("math.sin.poly", 0, MeasureCalls([](float x) { return slaModules::FastMath::Sin(x); }, angles), "ns/call");
+        Report("math.exp2.pow", 0, MeasureCalls([](float x) { return Legacy::Exp2(x); }, exponents), "ns/call");
+        Report("math.exp2.poly", 0, MeasureCalls([](float x) { return slaModules::FastMath::Exp2(x); }, exponents), "ns/call");
+        std::printf("\n");
+    }
+
+    void Run(uint32_t count)
+    {
+        // Keeps the total work per benchmark roughly independent of the actor count
+        const uint32_t ticks = std::max(5u, 1000000u / count);
+        const uint32_t reads = std::max(100000u, count * 4);
+
+        const int64_t before = liveBytes;
+        auto start = Clock::now();
+        auto actors = Populate(count, false);
+        Report("populate", count, SecondsSince(start) * 1e3, "ms");
+        Report("memory", count, double(liveBytes - before) / count, "bytes/actor");
+
+        const double eager = MeasureSweeps(ticks);
+        Report("update.eager", count, eager * 1e6, "us/sweep");
+        Report("update.eager.rate", count, count / eager / 1e6, "M actors/s");
+        Report("update.dormant", count, 100.0 * (count - slaModules::arousalData.AwakeCount()) / count, "%");
+        RunThreadScaling(count, ticks);
+
+        // One slice per tick, the way the scheduler thread would run them
+        auto& sliceStats = slaModules::UpdateScheduler::GetSingleton().GetStats();
+        sliceStats.Reset();
+        for (uint32_t i = 0; i < kSlices; ++i)
+        {
+            gameTime += kTickDays;
+            slaModules::UpdateScheduler::GetSingleton().RunSlice(gameTime, kSliceBudget);
+        }
+        Report("slice.actors", count, double(sliceStats.updates) / kSlices, "actors/slice");
+        Report("slice.max", count, sliceStats.maxNs / 1e3, "us");
+        Report("slice.overruns", count, 100.0 * sliceStats.overruns / kSlices, "%");
+        Report("slice.lag", count, sliceStats.updates ? sliceStats.totalLag / sliceStats.updates * 24.0 : 0.0, "game hours");
+
+        actors = Populate(count, true);
+        Report("update.lazy", count, MeasureSweeps(ticks) * 1e6, "us/sweep");
+
+        std::mt19937 rng(kSeed);
+        auto& cache = slaModules::actorCache;
+        const uint64_t hits = cache.GetHits();
+        const uint64_t misses = cache.GetMisses();
+        float sum = 0.f;
+        start = Clock::now();
+        for (uint32_t i = 0; i < reads; ++i)
+        {
+            // Scripts mostly re-read the actor they just touched
+            const FakeActor& actor = actors[i % 4 ? rng() % std::min<size_t>(actors.size(), 4) : rng() % actors.size()];
+            float time;
+            auto data = slaModules::GetArousalDataForRead(actor.formID, time);
+            sum += data->GetArousalAt(actor.formID, time);
+        }
+        const double readSeconds = SecondsSince(start);
+        Report("read.lazy", count, reads / readSeconds / 1e6, "M reads/s");
+        const uint64_t lookups = cache.GetHits() - hits + cache.GetMisses() - misses;
+        Report("read.cache.hits", count, lookups ? 100.0 * (cache.GetHits() - hits) / lookups : 0.0, "%");
+        if (std::isnan(sum))
+            std::printf("unexpected NaN arousal\n");
+
+        // Same reads again, each wrapped the way an instrumented native is
+        slaModules::NativeStats stats("GetArousal");
+        start = Clock::now();
+        for (uint32_t i = 0; i < reads; ++i)
+        {
+            slaModules::NativeScope scope(stats, cache);
+            const FakeActor& actor = actors[i % 4 ? rng() % std::min<size_t>(actors.size(), 4) : rng() % actors.size()];
+            float time;
+            auto data = slaModules::GetArousalDataForRead(actor.formID, time);
+            sum += data->GetArousalAt(actor.formID, time);
+        }
+        Report("read.lazy.stats", count, (SecondsSince(start) - readSeconds) / reads * 1e9, "ns/call overhead");
+
+        slaModules::SetLazyUpdateMode(false);
+        slaModules::MemorySerializationInterface intfc;
+        start = Clock::now();
+        slaModules::SaveData(&intfc, slaModules::recordWriter);
+        Report("save", count, SecondsSince(start) * 1e3, "ms");
+        Report("save.size", count, double(intfc.GetSize()) / count, "bytes/actor");
+        Report("save.writes", count, double(intfc.GetWriteCalls()), "calls");
+
+        slaModules::RevertData();
+        intfc.Rewind();
+        start = Clock::now();
+        slaModules::LoadData(&intfc);
+        Report("load", count, SecondsSince(start) * 1e3, "ms");
+        if (slaModules::arousalData.Size() != count)
+            std::printf("loaded %u of %u actors\n", slaModules::arousalData.Size(), count);
+
+        const double idleReads = MeasureSnapshotReads(actors, reads);
+        Report("read.snapshot", count, idleReads, "M reads/s");
+
+        const uint32_t queries = std::max(20u, 2000000u / count);
+        Report("rank.scan", count, MeasureRankingScan(queries), "us/query");
+        Report("rank.top", count, MeasureRankingQueries([](uint32_t) { return slaModules::arousalRanking.GetTop(kRankedActors).size(); }, queries * 10), "us/query");
+        Report("rank.count", count, MeasureRankingQueries([](uint32_t i) { return slaModules::arousalRanking.CountAbove(float(i % 100)) + 1; }, queries * 10), "us/query");
+
+        // Readers only touch the published summaries, so they can run next to a full update
+        std::atomic<bool> stop{ false };
+        std::atomic<uint32_t> sweeps{ 0 };
+        std::thread updater([&] {
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                gameTime += kTickDays;
+                slaModules::UpdateAllActors(gameTime);
+                sweeps.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        while (!sweeps.load(std::memory_order_relaxed))
+            std::this_thread::yield();
+        const double busyReads = MeasureSnapshotReads(actors, reads);
+        stop = true;
+        updater.join();
+        Report("read.snapshot.updating", count, busyReads, "M reads/s");
+
+        // Scaling of concurrent natives over the actor shards
+        double single = 0.0;
+        for (uint32_t threadCount = 1; threadCount <= kMaxStressThreads; threadCount *= 2)
+        {
+            const double rate = MeasureStress(actors, threadCount, reads / threadCount);
+            if (threadCount == 1)
+                single = rate;
+            Report("stress.t" + std::to_string(threadCount), count, rate, "M natives/s");
+            Report("stress.t" + std::to_string(threadCount) + ".scaling", count, rate / single, "x");
+        }
+    }
+
+    void WriteCsv(std::string const& path)
+    {
+        std::ofstream file(path);
+        file << "benchmark,actors,value,unit\n";
+        for (auto const& result : results)
+            file << result.name << ',' << result.actors << ',' << result.value << ',' << result.unit << '\n';
+    }
+
+    // Prints the change of every result against a CSV written by an earlier run
+    void CompareBaseline(std::string const& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::printf("could not open baseline %s\n", path.c_str());
+            return;
+        }
+        std::map<std::pair<std::string, uint32_t>, double> baseline;
+        std::string line;
+        std::getline(file, line);
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string name, actors, value;
+            if (std::getline(fields, name, ',') && std::getline(fields, actors, ',') && std::getline(fields, value, ','))
+                baseline[{ name, static_cast<uint32_t>(std::stoul(actors)) }] = std::stod(value);
+        }
+
+        std::printf("\n%-22s %8s %16s %16s %9s\n", "benchmark", "actors", "baseline", "current", "change");
+        for (auto const& result : results)
+        {
+            auto itr = baseline.find({ result.name, result.actors });
+            if (itr == baseline.end())
+                continue;
+            const double change = itr->second ? (result.value - itr->second) / itr->second * 100.0 : 0.0;
+            std::printf("%-22s %8u %16.3f %16.3f %+8.1f%%\n", result.name.c_str(), result.actors, itr->second, result.value, change);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    using namespace slaBench;
+
+    std::vector<uint32_t> counts;
+    std::string csvPath;
+    std::string baselinePath;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--actors" && i + 1 < argc)
+            counts.push_back(static_cast<uint32_t>(std::stoul(argv[++i])));
+        else if (arg == "--threads" && i + 1 < argc)
+            slaModules::UpdatePool::GetSingleton().SetThreadCount(static_cast<uint32_t>(std::stoul(argv[++i])));
+        else if (arg == "--csv" && i + 1 < argc)
+            csvPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselinePath = argv[++i];
+        else
+        {
+            std::printf("usage: %s [--actors N]... [--threads N] [--csv FILE] [--baseline FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (counts.empty())
+        counts = { 1000, 10000, 100000 };
+
+    slaModules::currentGameTime = GetGameTime;
+    std::printf("%s effect kernels, %u update threads\n\n", slaModules::effectKernels->name, slaModules::UpdatePool::GetSingleton().GetThreadCount());
+
+    Report("pool.resize.mismatches", 0, CountPoolResizeMismatches(), "chunks");
+    Report("unregister.stale", 0, CountStaleAfterUnregister(), "reads");
+    RunMath();
+    for (uint32_t count : counts)
+    {
+        if (count)
+            Run(count);
+    }
+
+    if (!csvPath.empty())
+        WriteCsv(csvPath);
+    if (!baselinePath.empty())
+        CompareBaseline(baselinePath);
+    return 0;
+}
@@ -0,0 +1,496 @@
+#include "Engine.h"
+#include "MemorySerialization.h"
+#include "NativeStats.h"
+#include "Trace.h"
+#include "UpdateScheduler.h"
+
+// Drives the engine from a trace recorded with StartNativeTrace and checks every return value
+// against the recorded one. The handlers below read the arguments the natives in Papyrus.h pass on.
+namespace slaReplay
+{
+    using namespace slaModules;
+
+    float gameTime = 0.f;
+
+    float GetGameTime()
+    {
+        return gameTime;
+    }
+
+    const size_t kMaxReportedDivergences = 20;
+
+    // Arguments and the recorded result of one call
+    class Call
+    {
+    public:
+        Call(RecordReader& reader, const char* native, uint64_t index) : reader(reader), native(native), index(index) {}
+
+        uint32_t Actor() { return reader.ReadVarint(); }
+        int32_t Int() { return reader.ReadSignedVarint(); }
+        float Float() { return reader.Read<float>(); }
+        bool Bool() { return reader.Read<uint8_t>() != 0; }
+        std::string String() { return std::string(reader.ReadVarintString()); }
+
+        std::vector<uint32_t> Actors()
+        {
+            std::vector<uint32_t> result(reader.ReadVarint());
+            for (auto& formId : result)
+                formId = Actor();
+            return result;
+        }
+
+        std::vector<std::string> Strings()
+        {
+            std::vector<std::string> result(reader.ReadVarint());
+            for (auto& value : result)
+                value = String();
+            return result;
+        }
+
+        std::vector<float> Floats()
+        {
+            std::vector<float> result(reader.ReadVarint());
+            for (float& value : result)
+                value = Float();
+            return result;
+        }
+
+        // Results are compared bit for bit, a replay has to be exact
+        void Expect(float actual)
+        {
+            const float expected = Float();
+            if (std::memcmp(&expected, &actual, sizeof(float)) != 0)
+                Diverge(std::to_string(expected), std::to_string(actual));
+        }
+
+        void Expect(int32_t actual) { Compare(Int(), actual); }
+        void Expect(uint32_t actual) { Compare(reader.ReadVarint(), actual); }
+        void Expect(bool actual) { Compare(Bool(), actual); }
+        void Expect(std::string_view actual) { Compare(String(), std::string(actual)); }
+
+        void Expect(std::vector<float> const& actual)
+        {
+            const uint32_t count = reader.ReadVarint();
+            if (count != actual.size())
+            {
+                Diverge(std::to_string(count) + " values", std::to_string(actual.size()) + " values");
+                for (uint32_t i = 0; i < count; ++i)
+                    Float();
+                return;
+            }
+            for (float value : actual)
+                Expect(value);
+        }
+
+        void Expect(std::vector<std::string> const& actual)
+        {
+            const auto expected = Strings();
+            if (expected.size() != actual.size())
+                Diverge(std::to_string(expected.size()) + " strings", std::to_string(actual.size()) + " strings");
+            else
+            {
+                for (size_t i = 0; i < expected.size(); ++i)
+                    Compare(expected[i], actual[i]);
+            }
+        }
+
+        void Expect(std::vector<uint32_t> const& actual)
+        {
+            const auto expected = Actors();
+            if (expected != actual)
+                Diverge(std::to_string(expected.size()) + " actors", std::to_string(actual.size()) + " actors");
+        }
+
+        // For results that depend on the host, like the thread count or which forms exist
+        void SkipInt() { Int(); }
+        void SkipActors() { Actors(); }
+
+        void SkipStrings()
+        {
+            const uint32_t count = reader.ReadVarint();
+            for (uint32_t i = 0; i < count; ++i)
+                reader.ReadVarintString();
+        }
+
+        bool Diverged() const { return diverged; }
+
+    private:
+        template <typename Ty>
+        void Compare(Ty const& expected, Ty const& actual)
+        {
+            if (expected != actual)
+            {
+                std::ostringstream expectedText, actualText;
+                expectedText << expected;
+                actualText << actual;
+                Diverge(expectedText.str(), actualText.str());
+            }
+        }
+
+        void Diverge(std::string const& expected, std::string const& actual)
+        {
+            // One report per call, later mismatches of the same call follow from the first
+            if (diverged)
+                return;
+            diverged = true;
+            if (++reported <= kMaxReportedDivergences)
+                std::printf("call %llu %s: recorded %s, replayed %s\n", static_cast<unsigned long long>(index), native, expected.c_str(), actual.c_str());
+        }
+
+        RecordReader& reader;
+        const char* native;
+        uint64_t index;
+        bool diverged = false;
+
+        static inline size_t reported = 0;
+    };
+
+    using Handler = void (*)(Call&);
+
+    // The natives themselves are shared with the plugin, see Natives in Engine.h
+    const std::unordered_map<std::string_view, Handler> handlers = {
+        { "GetStaticEffectCount", [](Call& call) { call.Expect(Natives::GetStaticEffectCount()); } },
+        { "RegisterStaticEffect", [](Call& call) { call.Expect(Natives::RegisterStaticEffect(call.String())); } },
+        { "UnregisterStaticEffect", [](Call& call) { call.Expect(Natives::UnregisterStaticEffect(call.String())); } },
+        { "RegisterEffectCurve", [](Call& call) {
+            const std::string name = call.String();
+            auto xs = call.Floats();
+            auto ys = call.Floats();
+            call.Expect(Natives::RegisterEffectCurve(name, std::move(xs), std::move(ys)));
+        } },
+        { "GetEffectCurveFunction", [](Call& call) { call.Expect(Natives::GetEffectCurveFunction(call.String())); } },
+        { "IsStaticEffectActive", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            call.Expect(Natives::IsStaticEffectActive(who, idx));
+        } },
+        { "GetDynamicEffectCount", [](Call& call) { call.Expect(Natives::GetDynamicEffectCount(call.Actor())); } },
+        { "GetDynamicEffect", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t number = call.Int();
+            call.Expect(std::string_view(Natives::GetDynamicEffect(who, number)));
+        } },
+        { "GetDynamicEffectValueByName", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const std::string name = call.String();
+            call.Expect(Natives::GetDynamicEffectValueByName(who, name));
+        } },
+        { "GetDynamicEffectValue", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t number = call.Int();
+            call.Expect(Natives::GetDynamicEffectValue(who, number));
+        } },
+        { "GetStaticEffectValue", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            call.Expect(Natives::GetStaticEffectValue(who, idx));
+        } },
+        { "GetStaticEffectParam", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            call.Expect(Natives::GetStaticEffectParam(who, idx));
+        } },
+        { "GetStaticEffectAux", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            call.Expect(Natives::GetStaticEffectAux(who, idx));
+        } },
+        { "SetStaticArousalEffect", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            const int32_t function = call.Int();
+            const float param = call.Float();
+            const float limit = call.Float();
+            const int32_t aux = call.Int();
+            Natives::SetStaticArousalEffect(who, idx, function, param, limit, aux);
+        } },
+        { "SetDynamicArousalEffect", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const std::string name = call.String();
+            const float initialValue = call.Float();
+            const int32_t function = call.Int();
+            const float param = call.Float();
+            const float limit = call.Float();
+            Natives::SetDynamicArousalEffect(who, name, initialValue, function, param, limit);
+        } },
+        { "ModDynamicArousalEffect", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const std::string name = call.String();
+            const float modifier = call.Float();
+            const float limit = call.Float();
+            Natives::ModDynamicArousalEffect(who, name, modifier, limit);
+        } },
+        { "SetStaticArousalValue", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            const float value = call.Float();
+            Natives::SetStaticArousalValue(who, idx, value);
+        } },
+        { "SetStaticAuxillaryFloat", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            const float value = call.Float();
+            Natives::SetStaticAuxillaryFloat(who, idx, value);
+        } },
+        { "SetStaticAuxillaryInt", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            const int32_t value = call.Int();
+            Natives::SetStaticAuxillaryInt(who, idx, value);
+        } },
+        { "ModStaticArousalValue", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            const float diff = call.Float();
+            const float limit = call.Float();
+            call.Expect(Natives::ModStaticArousalValue(who, idx, diff, limit));
+        } },
+        { "GetArousal", [](Call& call) { call.Expect(Natives::GetArousal(call.Actor())); } },
+        { "GetArousalBatch", [](Call& call) { call.Expect(Natives::GetArousalBatch(call.Actors())); } },
+        { "GetAllStaticEffectValues", [](Call& call) { call.Expect(Natives::GetAllStaticEffectValues(call.Actor())); } },
+        { "GetDynamicEffectNames", [](Call& call) {
+            const auto names = Natives::GetDynamicEffectNames(call.Actor());
+            call.Expect(std::vector<std::string>(names.begin(), names.end()));
+        } },
+        { "GetDynamicEffectValues", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const auto names = call.Strings();
+            call.Expect(Natives::GetDynamicEffectValues(who, names));
+        } },
+        { "GroupEffects", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            const int32_t idx2 = call.Int();
+            call.Expect(Natives::GroupEffects(who, idx, idx2));
+        } },
+        { "RemoveEffectGroup", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const int32_t idx = call.Int();
+            call.Expect(Natives::RemoveEffectGroup(who, idx));
+        } },
+        { "CleanUpActors", [](Call& call) { call.Expect(Natives::CleanUpActors(call.Float())); } },
+        { "UpdateSingleActorArousal", [](Call& call) {
+            const uint32_t who = call.Actor();
+            const float days = call.Float();
+            Natives::UpdateSingleActorArousal(who, days);
+        } },
+        { "UpdateActorsArousal", [](Call& call) {
+            const auto actors = call.Actors();
+            const float days = call.Float();
+            call.Expect(Natives::UpdateActorsArousal(actors, days));
+        } },
+        { "UpdateAllActorsArousal", [](Call& call) { call.Expect(Natives::UpdateAllActorsArousal(call.Float())); } },
+        { "IsLazyUpdate", [](Call& call) { call.Expect(Natives::IsLazyUpdate()); } },
+        { "SetLazyUpdate", [](Call& call) { Natives::SetLazyUpdate(call.Bool()); } },
+        { "GetUpdateThreadCount", [](Call& call) { call.SkipInt(); } },
+        // The replay keeps the thread count given on the command line
+        { "SetUpdateThreadCount", [](Call& call) { call.Int(); } },
+        // The replay never starts the scheduler, its slices are replayed from their own events
+        { "StartUpdateScheduler", [](Call& call) {
+            call.Int();
+            call.Int();
+            call.Bool();
+        } },
+        { "StopUpdateScheduler", [](Call&) {} },
+        { "IsUpdateSchedulerRunning", [](Call& call) { call.Bool(); } },
+        { "GetUpdateSchedulerStats", [](Call& call) {
+            call.Bool();
+            call.String();
+        } },
+        { "GetActorList", [](Call& call) { call.SkipActors(); } },
+        // The ranking is queried all the same, only which of its actors exist as forms depends on the host
+        { "GetMostArousedActors", [](Call& call) {
+            Natives::GetMostArousedActors(call.Int());
+            call.SkipActors();
+        } },
+        { "GetActorsInArousalRange", [](Call& call) {
+            const float minArousal = call.Float();
+            const float maxArousal = call.Float();
+            Natives::GetActorsInArousalRange(minArousal, maxArousal);
+            call.SkipActors();
+        } },
+        { "CountActorsAboveArousal", [](Call& call) { call.Expect(Natives::CountActorsAboveArousal(call.Float())); } },
+        { "TryLock", [](Call& call) { call.Expect(Natives::TryLock(call.Int())); } },
+        { "Unlock", [](Call& call) { Natives::Unlock(call.Int()); } },
+        { "DuplicateActorArray", [](Call& call) {
+            const auto actors = call.Actors();
+            call.Int();
+            call.Expect(actors);
+        } },
+        { "GetNativeStats", [](Call& call) { call.SkipStrings(); } },
+        { "DumpNativeStats", [](Call& call) { call.Bool(); } },
+        { "StartNativeTrace", [](Call& call) {
+            call.String();
+            call.Bool();
+        } },
+        { "StopNativeTrace", [](Call& call) { call.SkipInt(); } },
+    };
+
+    // Whether any snapshot had the scheduler running
+    bool schedulerRecorded = false;
+
+    void LoadSnapshot(RecordReader& reader)
+    {
+        const bool lazy = reader.Read<uint8_t>() != 0;
+        schedulerRecorded |= reader.Read<uint8_t>() != 0;
+        MemorySerializationInterface intfc;
+        intfc.Deserialize(reader);
+        SetLazyUpdateMode(false);
+        RevertData();
+        LoadData(&intfc);
+        SetLazyUpdateMode(lazy);
+    }
+
+    void ReplaySlice(RecordReader& reader)
+    {
+        const float time = reader.Read<float>();
+        std::vector<uint32_t> formIds(reader.ReadVarint());
+        for (auto& formId : formIds)
+            formId = reader.ReadVarint();
+        const uint32_t shards = reader.ReadVarint();
+        UpdateScheduler::GetSingleton().ReplaySlice(time, formIds, shards);
+    }
+
+    void Revert()
+    {
+        RevertData();
+        Natives::UnlockAll();
+    }
+
+    int Replay(std::string const& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::printf("could not open %s\n", path.c_str());
+            return 1;
+        }
+        RecordReader reader;
+        reader.Load(std::vector<char>(std::istreambuf_iterator<char>(file), {}));
+
+        if (reader.Read<uint32_t>() != kTraceMagic || reader.Read<uint32_t>() != kTraceVersion)
+        {
+            std::printf("%s is not a trace of this version\n", path.c_str());
+            return 1;
+        }
+        updateJitterSeed = reader.Read<uint64_t>();
+
+        struct Native
+        {
+            const char* name;
+            Handler handler;
+            NativeStats* stats;
+            uint64_t divergences;
+        };
+        std::vector<std::string> names(reader.ReadVarint());
+        std::vector<Native> natives;
+        natives.reserve(names.size());
+        for (auto& name : names)
+        {
+            name = reader.ReadVarintString();
+            auto itr = handlers.find(name);
+            natives.push_back({ name.c_str(), itr != handlers.end() ? itr->second : nullptr, &nativeStats.Add(name.c_str()), 0 });
+        }
+
+        uint64_t calls = 0;
+        uint64_t slices = 0;
+        uint64_t divergences = 0;
+        double callSeconds = 0.0;
+        try
+        {
+            while (reader.Remaining())
+            {
+                switch (reader.Read<TraceEvent>())
+                {
+                case TraceEvent::Call:
+                {
+                    const uint32_t id = reader.ReadVarint();
+                    if (id >= natives.size() || !natives[id].handler)
+                    {
+                        std::printf("call %llu: no handler for native %s\n", static_cast<unsigned long long>(calls),
+                            id < natives.size() ? natives[id].name : "?");
+                        return 1;
+                    }
+                    Native& native = natives[id];
+                    gameTime = reader.Read<float>();
+                    Call call(reader, native.name, calls++);
+                    const auto start = std::chrono::steady_clock::now();
+                    {
+                        NativeScope scope(*native.stats, actorCache);
+                        native.handler(call);
+                    }
+                    callSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    if (call.Diverged())
+                    {
+                        ++native.divergences;
+                        ++divergences;
+                    }
+                }
+                break;
+
+                case TraceEvent::Snapshot:
+                    LoadSnapshot(reader);
+                    break;
+
+                case TraceEvent::Revert:
+                    Revert();
+                    break;
+
+                case TraceEvent::Slice:
+                    ReplaySlice(reader);
+                    ++slices;
+                    break;
+
+                default:
+                    std::printf("call %llu: unknown event\n", static_cast<unsigned long long>(calls));
+                    return 1;
+                }
+            }
+        }
+        catch (std::exception const& e)
+        {
+            std::printf("trace ended unexpected after %llu calls: %s\n", static_cast<unsigned long long>(calls), e.what());
+            return 1;
+        }
+
+        std::printf("\n");
+        for (auto const& line : nativeStats.Format())
+            std::printf("%s\n", line.c_str());
+        for (auto const& native : natives)
+        {
+            if (native.divergences)
+                std::printf("%s: %llu divergences\n", native.name, static_cast<unsigned long long>(native.divergences));
+        }
+        std::printf("\n%llu calls in %.3f ms, %.3f M calls/s, %llu divergences\n", static_cast<unsigned long long>(calls),
+            callSeconds * 1e3, callSeconds > 0.0 ? calls / callSeconds / 1e6 : 0.0, static_cast<unsigned long long>(divergences));
+        if (schedulerRecorded || slices)
+            std::printf("%llu update scheduler slices\n", static_cast<unsigned long long>(slices));
+        return divergences ? 2 : 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+            slaModules::UpdatePool::GetSingleton().SetThreadCount(static_cast<uint32_t>(std::stoul(argv[++i])));
+        else if (path.empty() && arg.substr(0, 2) != "--")
+            path = argv[i];
+        else
+        {
+            path.clear();
+            break;
+        }
+    }
+    if (path.empty())
+    {
+        std::printf("usage: %s [--threads N] TRACE\n", argv[0]);
+        return 1;
+    }
+
+    slaModules::currentGameTime = slaReplay::GetGameTime;
+    return slaReplay::Replay(path);
+}
@@ -1,7 +1,21 @@
 set(headers ${headers}
+	src/ActorStore.h
 	src/Arousal.h
+	src/ArousalRanking.h
+	src/ArousalSnapshots.h
+	src/CorePCH.h
+	src/EffectCurves.h
+	src/EffectKernels.h
+	src/Engine.h
+	src/FastMath.h
+	src/MemorySerialization.h
+	src/NativeStats.h
 	src/Papyrus.h
 	src/PCH.h
 	src/Serialization.h
+	src/Symbols.h
+	src/Trace.h
+	src/UpdatePool.h
+	src/UpdateScheduler.h
 	src/Utils.h
 )
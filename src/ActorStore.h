@@ -0,0 +1,523 @@
+#pragma once
+
+#include "Arousal.h"
+
+namespace slaModules
+{
+    // Refers to a slot of an ActorStore. The generation changes whenever the slot is erased,
+    // so a handle to an erased actor resolves to nullptr instead of a reused or freed slot.
+    struct ActorHandle
+    {
+        static constexpr uint32_t kInvalidSlot = std::numeric_limits<uint32_t>::max();
+
+        uint32_t slot = kInvalidSlot;
+        uint32_t generation = 0;
+    };
+
+    // Arousal data keyed by formId. Data lives in fixed size slot chunks that never move, the lookup
+    // index is a linear probing table of (formId, slot) pairs that can rehash without touching the data.
+    //
+    // Actors without anything that changes over time can be made dormant, update sweeps only walk
+    // the awake ones. A dormant actor's lastUpdate is not touched while it sleeps, it is brought
+    // forward to the dormant time, when the sweeps last skipped it, once it wakes or is visited.
+    class ActorStore
+    {
+    public:
+        ActorStore() = default;
+        ActorStore(const ActorStore&) = delete;
+        ActorStore& operator=(const ActorStore&) = delete;
+
+        uint32_t Size() const { return count; }
+        uint32_t SlotCount() const { return static_cast<uint32_t>(chunks.size()) * kChunkSize; }
+        uint32_t AwakeCount() const { return awakeCount; }
+
+        // First slot at or after slot holding an awake actor, kInvalidSlot if there is none
+        uint32_t NextAwake(uint32_t slot) const
+        {
+            for (uint32_t chunk = slot / kChunkSize; chunk < awakeMasks.size(); ++chunk)
+            {
+                uint64_t bits = awakeMasks[chunk];
+                if (chunk == slot / kChunkSize)
+                    bits &= ~0ull << (slot % kChunkSize);
+                if (bits)
+                    return chunk * kChunkSize + CountTrailingZeros(bits);
+            }
+            return ActorHandle::kInvalidSlot;
+        }
+
+        // Calls func(slot) for every awake actor in slot order, func may put the actor to sleep
+        template <class Func>
+        void ForEachAwake(Func&& func)
+        {
+            for (uint32_t chunk = 0; chunk < awakeMasks.size(); ++chunk)
+            {
+                for (uint64_t bits = awakeMasks[chunk]; bits; bits &= bits - 1)
+                    func(chunk * kChunkSize + CountTrailingZeros(bits));
+            }
+        }
+
+        ActorHandle FindHandle(uint32_t formId) const
+        {
+            if (index.empty())
+                return {};
+            for (uint32_t pos = Ideal(formId);; pos = (pos + 1) & mask)
+            {
+                IndexEntry const& entry = index[pos];
+                if (entry.slot == ActorHandle::kInvalidSlot)
+                    return {};
+                if (entry.formId == formId)
+                    return { entry.slot, SlotAt(entry.slot).generation };
+            }
+        }
+
+        ActorHandle GetOrCreateHandle(uint32_t formId)
+        {
+            ActorHandle handle = FindHandle(formId);
+            if (handle.slot != ActorHandle::kInvalidSlot)
+                return handle;
+
+            if ((count + 1ull) * 4 > index.size() * 3ull)
+                Rehash(std::max<size_t>(index.size() * 2, kMinIndexSize));
+
+            const uint32_t slot = AllocateSlot();
+            Slot& target = SlotAt(slot);
+            target.formId = formId;
+            target.data.emplace();
+            SetAwake(slot, true);
+            InsertIndex(formId, slot);
+            ++count;
+            return { slot, target.generation };
+        }
+
+        ArousalData* Resolve(ActorHandle handle)
+        {
+            if (handle.slot >= SlotCount())
+                return nullptr;
+            Slot& slot = SlotAt(handle.slot);
+            return slot.data && slot.generation == handle.generation ? &*slot.data : nullptr;
+        }
+
+        ArousalData* Find(uint32_t formId) { return Resolve(FindHandle(formId)); }
+        ArousalData& GetOrCreate(uint32_t formId) { return *Resolve(GetOrCreateHandle(formId)); }
+
+        // Returns the data stored in a slot and its formId, or nullptr for free slots
+        ArousalData* AtSlot(uint32_t slot, uint32_t& formId)
+        {
+            Slot& target = SlotAt(slot);
+            formId = target.formId;
+            return target.data ? &*target.data : nullptr;
+        }
+
+        bool IsDormant(uint32_t slot) const { return !(awakeMasks[slot / kChunkSize] >> (slot % kChunkSize) & 1); }
+
+        void SetDormant(uint32_t slot) { SetAwake(slot, false); }
+
+        // O(1), the actor continues as if the sweeps had updated it all along
+        void Wake(uint32_t slot)
+        {
+            if (!IsDormant(slot))
+                return;
+            CatchUp(slot);
+            SetAwake(slot, true);
+        }
+
+        // Called by sweeps that skip the dormant actors, time is what they count as updated to
+        void SetDormantTime(float time) { dormantTime = std::max(dormantTime, time); }
+
+        bool Erase(uint32_t formId)
+        {
+            const ActorHandle handle = FindHandle(formId);
+            if (handle.slot == ActorHandle::kInvalidSlot)
+                return false;
+            EraseIndex(formId);
+            FreeSlot(handle.slot);
+            return true;
+        }
+
+        // Erases every actor for which pred(formId, data) returns true
+        template <class Pred>
+        uint32_t EraseIf(Pred&& pred)
+        {
+            uint32_t removed = 0;
+            for (uint32_t i = 0; i < SlotCount(); ++i)
+            {
+                Slot& slot = SlotAt(i);
+                if (!slot.data)
+                    continue;
+                CatchUp(i);
+                if (pred(slot.formId, static_cast<ArousalData const&>(*slot.data)))
+                {
+                    EraseIndex(slot.formId);
+                    FreeSlot(i);
+                    ++removed;
+                }
+            }
+            return removed;
+        }
+
+        template <class Func>
+        void ForEach(Func&& func)
+        {
+            for (uint32_t i = 0; i < SlotCount(); ++i)
+            {
+                Slot& slot = SlotAt(i);
+                if (!slot.data)
+                    continue;
+                CatchUp(i);
+                func(slot.formId, *slot.data);
+            }
+        }
+
+        template <class Func>
+        void ForEach(Func&& func) const
+        {
+            for (uint32_t i = 0; i < SlotCount(); ++i)
+            {
+                Slot const& slot = SlotAt(i);
+                if (slot.data)
+                    func(slot.formId, *slot.data);
+            }
+        }
+
+        // Slots are kept so that handles from before the clear keep failing their generation check
+        void Clear()
+        {
+            for (uint32_t i = 0; i < SlotCount(); ++i)
+                if (SlotAt(i).data)
+                    FreeSlot(i);
+            std::fill(index.begin(), index.end(), IndexEntry{});
+            expiries.clear();
+            dormantTime = 0.f;
+        }
+
+        // Queues the actor for PopExpired at its next expiry. Only an earlier expiry adds an entry,
+        // a later one is picked up when the old entry pops early.
+        void ScheduleExpiry(uint32_t formId)
+        {
+            const ActorHandle handle = FindHandle(formId);
+            if (handle.slot != ActorHandle::kInvalidSlot)
+                ScheduleSlot(handle.slot);
+        }
+
+        void ScheduleSlot(uint32_t slot)
+        {
+            Slot& target = SlotAt(slot);
+            const float time = target.data->GetNextExpiry();
+            if (!(time < target.scheduled))
+                return;
+            target.scheduled = time;
+            expiries.push_back({ time, { slot, target.generation } });
+            std::push_heap(expiries.begin(), expiries.end(), LaterExpiry);
+        }
+
+        void ScheduleAll()
+        {
+            for (uint32_t i = 0; i < SlotCount(); ++i)
+                if (SlotAt(i).data)
+                    ScheduleSlot(i);
+        }
+
+        void ClearExpiries()
+        {
+            for (Expiry const& expiry : expiries)
+                SlotAt(expiry.handle.slot).scheduled = kUnscheduled;
+            expiries.clear();
+        }
+
+        // Appends the slots of all actors that need an update at time. Each of them leaves the queue
+        // and has to be scheduled again after its update.
+        void PopExpired(float time, std::vector<uint32_t>& slots)
+        {
+            while (!expiries.empty() && expiries.front().time <= time)
+            {
+                std::pop_heap(expiries.begin(), expiries.end(), LaterExpiry);
+                const Expiry expiry = expiries.back();
+                expiries.pop_back();
+
+                // Entries of erased actors and superseded entries are dropped
+                Slot& target = SlotAt(expiry.handle.slot);
+                if (!target.data || target.generation != expiry.handle.generation || target.scheduled != expiry.time)
+                    continue;
+                target.scheduled = kUnscheduled;
+                if (target.data->NeedsUpdate(time))
+                    slots.push_back(expiry.handle.slot);
+                else
+                    ScheduleSlot(expiry.handle.slot);
+            }
+        }
+
+    private:
+        static constexpr uint32_t kChunkSize = 64;
+        static constexpr size_t kMinIndexSize = 64;
+        static_assert(kChunkSize == 64, "the awake mask of a chunk is a single word");
+        static constexpr float kUnscheduled = std::numeric_limits<float>::infinity();
+
+        struct Slot
+        {
+            uint32_t formId = 0;
+            uint32_t generation = 0;
+            // Time of the live expiry queue entry, kUnscheduled if there is none
+            float scheduled = kUnscheduled;
+            std::optional<ArousalData> data;
+        };
+
+        struct Expiry
+        {
+            float time;
+            ActorHandle handle;
+        };
+
+        static bool LaterExpiry(Expiry const& a, Expiry const& b) { return a.time > b.time; }
+
+        struct IndexEntry
+        {
+            uint32_t formId = 0;
+            uint32_t slot = ActorHandle::kInvalidSlot;
+        };
+
+        Slot& SlotAt(uint32_t slot) { return chunks[slot / kChunkSize][slot % kChunkSize]; }
+        Slot const& SlotAt(uint32_t slot) const { return chunks[slot / kChunkSize][slot % kChunkSize]; }
+
+        uint32_t Ideal(uint32_t formId) const
+        {
+            const uint32_t hash = formId * 0x9E3779B1u;
+            return (hash ^ (hash >> 16)) & mask;
+        }
+
+        uint32_t AllocateSlot()
+        {
+            if (freeSlots.empty())
+            {
+                const uint32_t first = SlotCount();
+                chunks.emplace_back(std::make_unique<Slot[]>(kChunkSize));
+                awakeMasks.push_back(0);
+                for (uint32_t i = kChunkSize; i > 0; --i)
+                    freeSlots.push_back(first + i - 1);
+            }
+            const uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            return slot;
+        }
+
+        void SetAwake(uint32_t slot, bool awake)
+        {
+            uint64_t& bits = awakeMasks[slot / kChunkSize];
+            const uint64_t bit = 1ull << (slot % kChunkSize);
+            if (((bits & bit) != 0) == awake)
+                return;
+            bits ^= bit;
+            awake ? ++awakeCount : --awakeCount;
+        }
+
+        void CatchUp(uint32_t slot)
+        {
+            if (IsDormant(slot))
+                SlotAt(slot).data->SkipIdleTime(dormantTime);
+        }
+
+        void FreeSlot(uint32_t slot)
+        {
+            SetDormant(slot);
+            Slot& target = SlotAt(slot);
+            target.data.reset();
+            target.scheduled = kUnscheduled;
+            ++target.generation;
+            freeSlots.push_back(slot);
+            --count;
+        }
+
+        void InsertIndex(uint32_t formId, uint32_t slot)
+        {
+            uint32_t pos = Ideal(formId);
+            while (index[pos].slot != ActorHandle::kInvalidSlot)
+                pos = (pos + 1) & mask;
+            index[pos] = { formId, slot };
+        }
+
+        // Backward shift deletion, keeps probe sequences intact without tombstones
+        void EraseIndex(uint32_t formId)
+        {
+            uint32_t hole = Ideal(formId);
+            while (index[hole].formId != formId || index[hole].slot == ActorHandle::kInvalidSlot)
+                hole = (hole + 1) & mask;
+
+            for (uint32_t pos = (hole + 1) & mask; index[pos].slot != ActorHandle::kInvalidSlot; pos = (pos + 1) & mask)
+            {
+                const uint32_t ideal = Ideal(index[pos].formId);
+                if (((pos - ideal) & mask) >= ((pos - hole) & mask))
+                {
+                    index[hole] = index[pos];
+                    hole = pos;
+                }
+            }
+            index[hole] = IndexEntry{};
+        }
+
+        void Rehash(size_t size)
+        {
+            std::vector<IndexEntry> old = std::move(index);
+            index.assign(size, IndexEntry{});
+            mask = static_cast<uint32_t>(size - 1);
+            for (IndexEntry const& entry : old)
+                if (entry.slot != ActorHandle::kInvalidSlot)
+                    InsertIndex(entry.formId, entry.slot);
+        }
+
+        std::vector<std::unique_ptr<Slot[]>> chunks;
+        std::vector<uint32_t> freeSlots;
+        std::vector<IndexEntry> index;
+        // Min-heap on time, entries are not removed when they go stale
+        std::vector<Expiry> expiries;
+        // One bit per slot, one word per chunk. Free slots count as dormant.
+        std::vector<uint64_t> awakeMasks;
+        uint32_t awakeCount = 0;
+        float dormantTime = 0.f;
+        uint32_t mask = 0;
+        uint32_t count = 0;
+    };
+
+    // Remembers the last few actors looked up on one thread. Entries are handles, so erasing an
+    // actor or growing the store only turns the affected entries into misses. A formId has to be
+    // looked up in the same store every time, which ShardedActorStore guarantees.
+    template <size_t N>
+    class ActorLookupCache
+    {
+    public:
+        ActorHandle GetOrCreateHandle(ActorStore& store, uint32_t formId)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                if (entries[i].formId != formId)
+                    continue;
+                if (store.Resolve(entries[i].handle))
+                {
+                    ++hits;
+                    return entries[i].handle;
+                }
+                return Refresh(store, i, formId);
+            }
+
+            const size_t victim = next;
+            next = (next + 1) % N;
+            return Refresh(store, victim, formId);
+        }
+
+        uint64_t GetHits() const { return hits; }
+        uint64_t GetMisses() const { return misses; }
+
+    private:
+        struct Entry
+        {
+            uint32_t formId = 0;
+            ActorHandle handle;
+        };
+
+        ActorHandle Refresh(ActorStore& store, size_t entry, uint32_t formId)
+        {
+            ++misses;
+            entries[entry] = { formId, store.GetOrCreateHandle(formId) };
+            return entries[entry].handle;
+        }
+
+        std::array<Entry, N> entries;
+        size_t next = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    // ActorStore split into shards by formId, each behind its own lock, so natives on actors in
+    // different shards never contend. A shard's store is only touched with its lock held. Whoever
+    // needs several shards locks them one at a time in index order.
+    class ShardedActorStore
+    {
+    public:
+        static constexpr uint32_t kShardBits = 4;
+        static constexpr uint32_t kShardCount = 1u << kShardBits;
+
+        struct alignas(64) Shard
+        {
+            std::mutex lock;
+            ActorStore store;
+        };
+
+        // Runs of 2^kRunBits consecutive formIds share a shard. Actors created together stay next to
+        // each other in memory, which keeps a sweep over a shard as cache friendly as one over a single store.
+        static constexpr uint32_t kRunBits = 6;
+
+        static uint32_t ShardIndex(uint32_t formId)
+        {
+            const uint32_t run = formId >> kRunBits;
+            // The top byte of a formId is the load order index, mixing it in spreads every plugin over all shards
+            return (run ^ (run >> (24 - kRunBits)) ^ (run >> kShardBits)) & (kShardCount - 1);
+        }
+
+        Shard& ShardOf(uint32_t formId) { return shards[ShardIndex(formId)]; }
+        Shard& ShardAt(uint32_t index) { return shards[index]; }
+
+        uint32_t AwakeCount()
+        {
+            uint32_t total = 0;
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                total += shard.store.AwakeCount();
+            }
+            return total;
+        }
+
+        uint32_t Size()
+        {
+            uint32_t total = 0;
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                total += shard.store.Size();
+            }
+            return total;
+        }
+
+        // func(formId, data) runs with the actor's shard locked
+        template <class Func>
+        void ForEach(Func&& func)
+        {
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.store.ForEach(func);
+            }
+        }
+
+        template <class Pred>
+        uint32_t EraseIf(Pred&& pred)
+        {
+            uint32_t removed = 0;
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                removed += shard.store.EraseIf(pred);
+            }
+            return removed;
+        }
+
+        void Clear()
+        {
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.store.Clear();
+            }
+        }
+
+        // For walks that have to see a single consistent state, like saving
+        std::array<std::unique_lock<std::mutex>, kShardCount> LockAll()
+        {
+            std::array<std::unique_lock<std::mutex>, kShardCount> locks;
+            for (uint32_t i = 0; i < kShardCount; ++i)
+                locks[i] = std::unique_lock<std::mutex>(shards[i].lock);
+            return locks;
+        }
+
+    private:
+        std::array<Shard, kShardCount> shards;
+    };
+}
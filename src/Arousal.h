@@ -1,20 +1,12 @@
 #pragma once
 
+#include "EffectKernels.h"
 #include "Serialization.h"
+#include "Symbols.h"
 #include "Utils.h"
 
 namespace slaModules
 {
-    uint32_t staticEffectCount = 0;
-    std::unordered_map<std::string, uint32_t> staticEffectIds;
-
-    float GetEffectLimitOffset(uint32_t effectIdx)
-    {
-        if (effectIdx == 1)
-            return 0.5;
-        return 0.0;
-    }
-
     struct ArousalEffectGroup
     {
         ArousalEffectGroup() : value(0.f) {}
@@ -22,8 +14,6 @@ namespace slaModules
         float value;
     };
 
-    using ArousalEffectGroupPtr = std::shared_ptr<ArousalEffectGroup>;
-
     struct ArousalEffectData
     {
         ArousalEffectData() : value(0.f), function(0), param(0.f), limit(0.f), intAux(0) {}
@@ -37,6 +27,11 @@ namespace slaModules
             int32_t intAux;
         };
 
+        bool IsDefault() const
+        {
+            return !value && !function && !param && !limit && !intAux;
+        }
+
         void Set(int32_t a_functionId, float a_param, float a_limit, int32_t a_auxilliary)
         {
             function = a_functionId;
@@ -46,182 +41,473 @@ namespace slaModules
         }
     };
 
-    class ArousalData
+    // Static effects of a single actor, stored column-wise. The kind masks bucket the active effects by
+    // the kind of their function, the grouped mask mirrors the group column and marks effects that are
+    // evaluated through their group.
+    class StaticEffectTable
     {
     public:
-        ArousalData() : staticEffects(staticEffectCount), staticEffectGroups(staticEffectCount), arousal(0.f), lastUpdate(0.f), lockedArousal(std::numeric_limits<float>::quiet_NaN()) {}
-        ArousalData(SKSE::SerializationInterface* intfc, uint32_t& length) : ArousalData()
+        static constexpr uint16_t kNoGroup = std::numeric_limits<uint16_t>::max();
+
+        explicit StaticEffectTable(uint32_t count = 0) { Resize(count); }
+
+        uint32_t Size() const { return static_cast<uint32_t>(values.size()); }
+
+        void Resize(uint32_t count)
         {
-            arousal = ReadDataHelper<float>(intfc, length);
-            lastUpdate = ReadDataHelper<float>(intfc, length);
-            uint32_t count = ReadDataHelper<uint32_t>(intfc, length);
-            for (uint32_t j = 0; j < count; ++j)
-                staticEffects[j] = ReadDataHelper<ArousalEffectData>(intfc, length);
+            values.resize(count, 0.f);
+            functions.resize(count, 0);
+            params.resize(count, 0.f);
+            limits.resize(count, 0.f);
+            auxiliaries.resize(count, 0);
+            groups.resize(count, kNoGroup);
+            kindMasks.resize((count + 63) / 64 * kEffectKindCount, 0);
+            groupedMask.resize((count + 63) / 64, 0);
+        }
 
-            count = ReadDataHelper<uint8_t>(intfc, length);
-            for (uint32_t j = 0; j < count; ++j)
+        ArousalEffectData Get(uint32_t idx) const
+        {
+            ArousalEffectData effect;
+            effect.value = values[idx];
+            effect.function = functions[idx];
+            effect.param = params[idx];
+            effect.limit = limits[idx];
+            effect.intAux = auxiliaries[idx];
+            return effect;
+        }
+
+        void Put(uint32_t idx, ArousalEffectData const& effect)
+        {
+            values[idx] = effect.value;
+            params[idx] = effect.param;
+            limits[idx] = effect.limit;
+            auxiliaries[idx] = effect.intAux;
+            SetFunction(idx, effect.function);
+        }
+
+        void Set(uint32_t idx, int32_t a_functionId, float a_param, float a_limit, int32_t a_auxilliary)
+        {
+            params[idx] = a_param;
+            limits[idx] = a_limit + GetEffectLimitOffset(a_functionId);
+            auxiliaries[idx] = a_auxilliary;
+            SetFunction(idx, a_functionId);
+        }
+
+        float& Value(uint32_t idx) { return values[idx]; }
+        float Value(uint32_t idx) const { return values[idx]; }
+        int32_t Function(uint32_t idx) const { return functions[idx]; }
+        float Param(uint32_t idx) const { return params[idx]; }
+        float Limit(uint32_t idx) const { return limits[idx]; }
+        int32_t IntAux(uint32_t idx) const { return auxiliaries[idx]; }
+        uint16_t Group(uint32_t idx) const { return groups[idx]; }
+
+        void SetIntAux(uint32_t idx, int32_t value) { auxiliaries[idx] = value; }
+        void SetFloatAux(uint32_t idx, float value) { std::memcpy(&auxiliaries[idx], &value, sizeof(value)); }
+
+        void Deactivate(uint32_t idx) { SetFunction(idx, 0); }
+
+        // Bits of the active, ungrouped effects word * 64 to word * 64 + 63
+        uint64_t UpdatedBits(uint32_t word) const { return word < groupedMask.size() ? ActiveBits(word) & ~groupedMask[word] : 0; }
+
+        bool AnyActive() const
+        {
+            return std::any_of(kindMasks.begin(), kindMasks.end(), [](uint64_t bits) { return bits != 0; });
+        }
+
+        bool IsActive(uint32_t idx) const { return functions[idx] != 0; }
+        bool IsGrouped(uint32_t idx) const { return TestBit(groupedMask, idx); }
+        bool IsUpdated(uint32_t idx) const { return IsActive(idx) && !IsGrouped(idx); }
+
+        void SetGroup(uint32_t idx, uint16_t group)
+        {
+            groups[idx] = group;
+            AssignBit(groupedMask, idx, group != kNoGroup);
+        }
+
+        uint32_t UpdatedCount() const
+        {
+            uint32_t count = 0;
+            ForEachUpdated([&](uint32_t) { ++count; });
+            return count;
+        }
+
+        // Calls fn(idx) for every active, ungrouped effect in index order. fn may deactivate idx.
+        template <typename Fn>
+        void ForEachUpdated(Fn&& fn) const
+        {
+            for (uint32_t word = 0; word < groupedMask.size(); ++word)
+                ForEachBit(ActiveBits(word) & ~groupedMask[word], word, fn);
+        }
+
+        // Same for the effects of one kind
+        template <typename Fn>
+        void ForEachUpdated(uint32_t kind, Fn&& fn) const
+        {
+            for (uint32_t word = 0; word < groupedMask.size(); ++word)
+                ForEachBit(kindMasks[word * kEffectKindCount + kind] & ~groupedMask[word], word, fn);
+        }
+
+    private:
+        static bool TestBit(std::vector<uint64_t> const& mask, uint32_t idx) { return (mask[idx / 64] >> (idx % 64)) & 1; }
+
+        template <typename Fn>
+        static void ForEachBit(uint64_t bits, uint32_t word, Fn& fn)
+        {
+            while (bits)
             {
-                auto grp = std::make_shared<ArousalEffectGroup>();
-                uint32_t grpEntiryCount = ReadDataHelper<uint32_t>(intfc, length);
-                for (uint32_t k = 0; k < grpEntiryCount; ++k)
-                {
-                    uint32_t effIdx = ReadDataHelper<uint32_t>(intfc, length);
-                    grp->staticEffectIds.emplace_back(effIdx);
-                    staticEffectGroups[effIdx] = grp;
-                }
-                grp->value = ReadDataHelper<float>(intfc, length);
-                if (std::abs(grp->value) > 10000.f)
-                {
-                    logger::info("Possibly corrupted data reseting to zero");
-                    grp->value = 0.f;
-                }
-                groupsToUpdate.emplace_back(std::move(grp));
+                fn(word * 64 + CountTrailingZeros(bits));
+                bits &= bits - 1;
             }
-            count = ReadDataHelper<uint32_t>(intfc, length);
-            for (uint32_t j = 0; j < count; ++j)
-                staticEffectsToUpdate.insert(ReadDataHelper<uint32_t>(intfc, length));
-            count = ReadDataHelper<uint32_t>(intfc, length);
-            for (uint32_t j = 0; j < count; ++j) {
-                std::string name = ReadString(intfc, length);
-                dynamicEffects[name] = ReadDataHelper<ArousalEffectData>(intfc, length);
+        }
+
+        uint64_t ActiveBits(uint32_t word) const
+        {
+            uint64_t bits = 0;
+            for (uint32_t kind = 0; kind < kEffectKindCount; ++kind)
+                bits |= kindMasks[word * kEffectKindCount + kind];
+            return bits;
+        }
+
+        static void AssignBit(std::vector<uint64_t>& mask, uint32_t idx, bool set)
+        {
+            const uint64_t bit = 1ull << (idx % 64);
+            if (set)
+                mask[idx / 64] |= bit;
+            else
+                mask[idx / 64] &= ~bit;
+        }
+
+        // Moves the effect into the bucket of its new kind, the only place the kind is looked up
+        void SetFunction(uint32_t idx, int32_t function)
+        {
+            const uint64_t bit = 1ull << (idx % 64);
+            uint64_t* masks = &kindMasks[idx / 64 * kEffectKindCount];
+            if (functions[idx])
+                masks[GetEffectKind(functions[idx])] &= ~bit;
+            if (function)
+                masks[GetEffectKind(function)] |= bit;
+            functions[idx] = function;
+        }
+
+        std::vector<float> values;
+        std::vector<int32_t> functions;
+        std::vector<float> params;
+        std::vector<float> limits;
+        std::vector<int32_t> auxiliaries;
+        std::vector<uint16_t> groups;
+        // kEffectKindCount words per 64 effects
+        std::vector<uint64_t> kindMasks;
+        std::vector<uint64_t> groupedMask;
+    };
+
+    // Dynamic effects of a single actor, dense and addressable by position or by name.
+    // Removal moves the last effect into the freed position, the order is otherwise stable.
+    class DynamicEffectList
+    {
+    public:
+        struct Entry
+        {
+            uint32_t name;
+            ArousalEffectData effect;
+        };
+
+        uint32_t Size() const { return static_cast<uint32_t>(entries.size()); }
+
+        Entry& At(uint32_t position) { return entries[position]; }
+        Entry const& At(uint32_t position) const { return entries[position]; }
+
+        ArousalEffectData const* Find(uint32_t name) const
+        {
+            auto itr = positions.find(name);
+            return itr != positions.end() ? &entries[itr->second].effect : nullptr;
+        }
+
+        ArousalEffectData& GetOrCreate(uint32_t name)
+        {
+            auto result = positions.emplace(name, Size());
+            if (result.second)
+                entries.push_back({ name, ArousalEffectData() });
+            return entries[result.first->second].effect;
+        }
+
+        void Remove(uint32_t name)
+        {
+            auto itr = positions.find(name);
+            if (itr == positions.end())
+                return;
+            const uint32_t position = itr->second;
+            positions.erase(itr);
+            if (position != entries.size() - 1)
+            {
+                entries[position] = entries.back();
+                positions[entries[position].name] = position;
             }
-            count = ReadDataHelper<uint32_t>(intfc, length);
-            for (uint32_t j = 0; j < count; ++j)
-                dynamicEffectsToUpdate.insert(ReadString(intfc, length));
+            entries.pop_back();
+        }
+
+        std::vector<Entry>::const_iterator begin() const { return entries.begin(); }
+        std::vector<Entry>::const_iterator end() const { return entries.end(); }
+
+    private:
+        std::vector<Entry> entries;
+        std::unordered_map<uint32_t, uint32_t> positions;
+    };
+
+    // The part of an actor readers can get without touching its ArousalData, see ArousalSnapshots
+    struct ArousalSummary
+    {
+        float arousal = 0.f;
+        float lastUpdate = 0.f;
+        float nextExpiry = 0.f;
+        // Nothing changes with time, the arousal is the same at any time before nextExpiry
+        bool constant = false;
+        int32_t dynamicEffectCount = 0;
+        // IsStaticEffectActive of the effects 0 to 63
+        uint64_t activeStaticEffects = 0;
+    };
+
+    // Picked once per session, traces record it so a replay starts new actors at the same time
+    uint64_t updateJitterSeed = 0;
+
+    // How long before its first update a new actor pretends to have been updated last. Normal
+    // distribution around half a day, derived from the seed and formId only so it does not
+    // depend on the order actors are created in.
+    float GetInitialUpdateJitter(uint32_t formId)
+    {
+        const uint64_t first = Mix64(updateJitterSeed ^ formId);
+        const uint64_t second = Mix64(first);
+        // Box-Muller, u1 in (0, 1] keeps the logarithm finite
+        const double u1 = static_cast<double>((first >> 11) + 1) * 0x1.0p-53;
+        const double u2 = static_cast<double>(second >> 11) * 0x1.0p-53;
+        const double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * 3.14159265358979323846 * u2);
+        return std::abs(static_cast<float>(0.5 + 2.0 * normal));
+    }
+
+    class ArousalData
+    {
+    public:
+        ArousalData() : arousal(0.f), lastUpdate(0.f), nextExpiry(0.f), lockedArousal(std::numeric_limits<float>::quiet_NaN()) {}
+        // symbolMap translates the symbol ids of the record, version 1 records store names inline
+        ArousalData(RecordReader& reader, uint32_t version, std::vector<uint32_t> const& symbolMap) : ArousalData()
+        {
+            if (version >= 3)
+                ReadCompact(reader, symbolMap);
+            else
+                ReadLegacy(reader, version >= 2 ? &symbolMap : nullptr);
 
             float recalculated = 0.f;
-            for (uint32_t i = 0; i < staticEffects.size(); ++i)
+            for (uint32_t i = 0; i < staticEffects.Size(); ++i)
             {
-                if (!staticEffectGroups[i])
-                    recalculated += staticEffects[i].value;
+                if (!staticEffects.IsGrouped(i))
+                    recalculated += staticEffects.Value(i);
             }
-            for (auto const& eff : dynamicEffects)
-                recalculated += eff.second.value;
-            for (auto const& grp : groupsToUpdate)
-                recalculated += grp->value;
+            for (auto const& entry : dynamicEffects)
+                recalculated += entry.effect.value;
+            for (auto const& grp : groups)
+                recalculated += grp.value;
+            // Rounding differs from the running sum in the last bits, keeping the saved value makes a
+            // save and load exact, which trace snapshots rely on
             if (std::abs(recalculated - arousal) > 0.5)
+            {
                 logger::info("Arousal data mismatch: Expected: {} Got: {}", recalculated, arousal);
-            arousal = recalculated;
+                arousal = recalculated;
+            }
+            ScheduleExpiry();
         }
         ArousalData& operator=(ArousalData&& other) = default;
 
-        void Serialize(SKSE::SerializationInterface* intfc) const
+        // Writes the compact layout of version 3. Counts and ids are varints, static effects that
+        // still hold their default are only marked absent in a presence bitmap, and the lists of
+        // effects to update are left out because they follow from the effect functions.
+        void Serialize(RecordWriter& writer) const
         {
-            WriteData(intfc, &arousal);
-            WriteData(intfc, &lastUpdate);
-            WriteContainerData(intfc, staticEffects);
-            uint8_t groupCount = static_cast<uint8_t>(groupsToUpdate.size());
-            WriteData(intfc, &groupCount);
-            for (auto& group : groupsToUpdate)
+            writer.Write(arousal);
+            writer.Write(lastUpdate);
+
+            uint32_t size = staticEffects.Size();
+            while (size > 0 && IsDefaultStaticEffect(size - 1))
+                --size;
+            writer.WriteVarint(size);
+            for (uint32_t i = 0; i < size; i += 8)
+            {
+                uint8_t present = 0;
+                for (uint32_t bit = 0; bit < 8 && i + bit < size; ++bit)
+                {
+                    if (!IsDefaultStaticEffect(i + bit))
+                        present |= 1 << bit;
+                }
+                writer.Write(present);
+            }
+            for (uint32_t i = 0; i < size; ++i)
             {
-                WriteContainerData(intfc, group->staticEffectIds);
-                WriteData(intfc, &group->value);
+                if (!IsDefaultStaticEffect(i))
+                    WriteCompactEffect(writer, staticEffects.Get(i));
             }
-            WriteContainerData(intfc, staticEffectsToUpdate);
-            uint32_t size = static_cast<uint32_t>(dynamicEffects.size());
-            intfc->WriteRecordData(&size, sizeof(size));
-            for (auto const& kvp : dynamicEffects)
+
+            writer.WriteVarint(static_cast<uint32_t>(groups.size()));
+            for (auto const& group : groups)
             {
-                WriteString(intfc, kvp.first);
-                intfc->WriteRecordData(&kvp.second, sizeof(kvp.second));
+                writer.WriteVarint(static_cast<uint32_t>(group.staticEffectIds.size()));
+                for (uint32_t id : group.staticEffectIds)
+                    writer.WriteVarint(id);
+                writer.Write(group.value);
             }
-            size = static_cast<uint32_t>(dynamicEffectsToUpdate.size());
-            intfc->WriteRecordData(&size, sizeof(size));
-            for (auto const& toUpdate : dynamicEffectsToUpdate)
-                WriteString(intfc, toUpdate);
-        }
 
-        void OnRegisterStaticEffect()
-        {
-            staticEffects.emplace_back();
-            staticEffectGroups.emplace_back(nullptr);
+            writer.WriteVarint(dynamicEffects.Size());
+            for (auto const& entry : dynamicEffects)
+            {
+                writer.WriteVarint(entry.name);
+                WriteCompactEffect(writer, entry.effect);
+            }
         }
 
-        void OnUnregisterStaticEffect(uint32_t id)
+        // False if the actor never touched the effect, nothing changed then
+        bool OnUnregisterStaticEffect(uint32_t id)
         {
-            // staticEffects.erase(staticEffects.begin() + id);
-            // staticEffectGroups.erase(staticEffectGroups.begin() + id);
+            // Effects the actor never touched are still default
+            if (id >= staticEffects.Size())
+                return false;
             try
             {
                 SetStaticArousalValue(id, 0.f);
                 SetStaticArousalEffect(id, 0, 0.f, 0.f, 0);
-                if (staticEffectGroups[id])
+                if (staticEffects.IsGrouped(id))
                     RemoveEffectGroup(id);
             }
             catch (std::exception ex)
             {
                 logger::info("Unexpected exception in OnUnregisterStaticEffect: {}", ex.what());
             }
+            return true;
         }
 
-        ArousalEffectGroupPtr GetEffectGroup(int32_t effectIdx)
+        ArousalEffectGroup const* GetEffectGroup(int32_t effectIdx) const
         {
-            if (effectIdx < 0 || effectIdx >= staticEffects.size())
-                throw std::invalid_argument("Invalid static effect index");
-            return staticEffectGroups[effectIdx];
+            const uint32_t idx = CheckStaticEffectIndex(effectIdx);
+            const uint16_t group = idx < staticEffects.Size() ? staticEffects.Group(idx) : StaticEffectTable::kNoGroup;
+            return group != StaticEffectTable::kNoGroup ? &groups[group] : nullptr;
         }
 
-        ArousalEffectData& GetStaticArousalEffect(int32_t effectIdx)
+        ArousalEffectData GetStaticArousalEffect(int32_t effectIdx) const
         {
-            if (effectIdx < 0 || effectIdx >= staticEffects.size())
-                throw std::invalid_argument("Invalid static effect index");
-            return staticEffects[effectIdx];
+            const uint32_t idx = CheckStaticEffectIndex(effectIdx);
+            return idx < staticEffects.Size() ? staticEffects.Get(idx) : ArousalEffectData();
+        }
+
+        void SetStaticAuxillaryFloat(int32_t effectIdx, float value)
+        {
+            staticEffects.SetFloatAux(GrowStaticEffect(effectIdx), value);
+        }
+
+        void SetStaticAuxillaryInt(int32_t effectIdx, int32_t value)
+        {
+            staticEffects.SetIntAux(GrowStaticEffect(effectIdx), value);
         }
 
         int32_t GetDynamicEffectCount() const
         {
-            return static_cast<int32_t>(dynamicEffects.size());
+            return static_cast<int32_t>(dynamicEffects.Size());
         }
 
-        RE::BSFixedString GetDynamicEffect(int32_t number) const
+        const char* GetDynamicEffect(int32_t number) const
         {
-            if (number >= dynamicEffects.size())
+            if (number < 0 || static_cast<uint32_t>(number) >= dynamicEffects.Size())
                 return "";
-            auto itr = dynamicEffects.begin();
-            std::advance(itr, number);
-            return itr->first.c_str();
+            return symbols.Name(dynamicEffects.At(number).name).c_str();
         }
 
         float GetDynamicEffectValue(int32_t number) const
         {
-            if (number >= dynamicEffects.size())
+            if (number < 0 || static_cast<uint32_t>(number) >= dynamicEffects.Size())
                 return std::numeric_limits<float>::lowest();
-            auto itr = dynamicEffects.begin();
-            std::advance(itr, number);
-            return itr->second.value;
+            return dynamicEffects.At(number).effect.value;
         }
 
-        float GetDynamicEffectValueByName(RE::BSFixedString effectId) const
+        float GetDynamicEffectValueByName(std::string_view effectId) const
         {
-            std::string effectName(effectId.data());
+            auto effect = dynamicEffects.Find(symbols.Find(effectId));
+            return effect ? effect->value : 0.f;
+        }
 
-            auto itr = dynamicEffects.find(effectName);
-            if (itr != dynamicEffects.end())
-                return itr->second.value;
-            else
+        // The *At getters project the stored values, which are as of lastUpdate, to the given game time.
+        // The projection is exact as long as time is before GetNextExpiry, an update is needed past that.
+
+        float GetArousalAt(uint32_t formId, float time) const
+        {
+            if (time <= lastUpdate)
+                return arousal;
+            float result = arousal;
+            for (auto const& group : groups)
+                result += ProjectGroup(group, formId, time) - group.value;
+            staticEffects.ForEachUpdated([&](uint32_t idx) {
+                result += ProjectEffect(staticEffects.Value(idx), staticEffects.Function(idx), staticEffects.Param(idx), staticEffects.Limit(idx), formId, time) - staticEffects.Value(idx);
+            });
+            for (auto const& entry : dynamicEffects)
+                result += ProjectEffect(entry.effect, formId, time) - entry.effect.value;
+            return result;
+        }
+
+        float GetStaticEffectValueAt(int32_t effectIdx, uint32_t formId, float time) const
+        {
+            const uint32_t idx = CheckStaticEffectIndex(effectIdx);
+            if (idx >= staticEffects.Size())
                 return 0.f;
+            if (staticEffects.IsGrouped(idx))
+                return ProjectGroup(groups[staticEffects.Group(idx)], formId, time);
+            return ProjectEffect(staticEffects.Value(idx), staticEffects.Function(idx), staticEffects.Param(idx), staticEffects.Limit(idx), formId, time);
         }
 
-        bool IsStaticEffectActive(int32_t effectIdx)
+        // GetStaticEffectValueAt of every valid effect index in one pass, grouped effects get their group's value
+        std::vector<float> GetStaticEffectValuesAt(uint32_t formId, float time) const
         {
-            return staticEffectsToUpdate.find(effectIdx) != staticEffectsToUpdate.end();
+            std::vector<float> result(std::max(staticEffectRegistry.Size(), staticEffects.Size()), 0.f);
+            std::vector<float> groupValues(groups.size());
+            for (size_t i = 0; i < groups.size(); ++i)
+                groupValues[i] = ProjectGroup(groups[i], formId, time);
+            for (uint32_t idx = 0; idx < staticEffects.Size(); ++idx)
+            {
+                if (staticEffects.IsGrouped(idx))
+                    result[idx] = groupValues[staticEffects.Group(idx)];
+                else
+                    result[idx] = ProjectEffect(staticEffects.Value(idx), staticEffects.Function(idx), staticEffects.Param(idx), staticEffects.Limit(idx), formId, time);
+            }
+            return result;
         }
 
-        void RemoveDynamicEffectIfNeeded(std::string effectName, ArousalEffectData& effect)
+        float GetDynamicEffectValueAt(int32_t number, uint32_t formId, float time) const
         {
-            if (effect.function == 0 && effect.value == 0.f)
-                dynamicEffects.erase(effectName);
+            if (number < 0 || static_cast<uint32_t>(number) >= dynamicEffects.Size())
+                return std::numeric_limits<float>::lowest();
+            return ProjectEffect(dynamicEffects.At(number).effect, formId, time);
+        }
+
+        float GetDynamicEffectValueByNameAt(std::string_view effectId, uint32_t formId, float time) const
+        {
+            auto effect = dynamicEffects.Find(symbols.Find(effectId));
+            return effect ? ProjectEffect(*effect, formId, time) : 0.f;
         }
 
-        void SetDynamicArousalEffect(RE::BSFixedString effectId, float initialValue, int32_t functionId, float param, float limit)
+        // Never updated actors have no reference time yet and always need an update
+        bool NeedsUpdate(float time) const
         {
-            std::string effectName(effectId.data());
-            ArousalEffectData& effect = dynamicEffects[effectName];
+            return !lastUpdate || time >= nextExpiry;
+        }
 
-            if (functionId && !effect.function)
-                dynamicEffectsToUpdate.insert(effectName);
-            else if (!functionId && effect.function)
-                dynamicEffectsToUpdate.erase(effectName);
+        bool IsStaticEffectActive(int32_t effectIdx) const
+        {
+            return effectIdx >= 0 && static_cast<uint32_t>(effectIdx) < staticEffects.Size() && staticEffects.IsUpdated(effectIdx);
+        }
+
+        void RemoveDynamicEffectIfNeeded(uint32_t effectName, ArousalEffectData& effect)
+        {
+            if (effect.function == 0 && effect.value == 0.f)
+                dynamicEffects.Remove(effectName);
+        }
+
+        void SetDynamicArousalEffect(std::string_view effectId, float initialValue, int32_t functionId, float param, float limit)
+        {
+            uint32_t effectName = symbols.Intern(effectId);
+            ArousalEffectData& effect = dynamicEffects.GetOrCreate(effectName);
 
             effect.Set(functionId, param, limit, 0);
             if (initialValue)
@@ -229,13 +515,14 @@ namespace slaModules
                 arousal += initialValue - effect.value;
                 effect.value = initialValue;
             }
-            RemoveDynamicEffectIfNeeded(std::move(effectName), effect);
+            RemoveDynamicEffectIfNeeded(effectName, effect);
+            ScheduleExpiry();
         }
 
-        void ModDynamicArousalEffect(RE::BSFixedString effectId, float modifier, float limit)
+        void ModDynamicArousalEffect(std::string_view effectId, float modifier, float limit)
         {
-            std::string effectName(effectId.data());
-            ArousalEffectData& effect = dynamicEffects[effectName];
+            uint32_t effectName = symbols.Intern(effectId);
+            ArousalEffectData& effect = dynamicEffects.GetOrCreate(effectName);
 
             float value = effect.value + modifier;
             float actualDiff = modifier;
@@ -246,205 +533,216 @@ namespace slaModules
             }
             arousal += actualDiff;
             effect.value = value;
-            RemoveDynamicEffectIfNeeded(std::move(effectName), effect);
+            RemoveDynamicEffectIfNeeded(effectName, effect);
+            ScheduleExpiry();
         }
 
         void SetStaticArousalEffect(int32_t effectIdx, int32_t functionId, float param, float limit, int32_t auxilliary)
         {
-            ArousalEffectData& effect = GetStaticArousalEffect(effectIdx);
-
-            if (functionId && !effect.function)
-                staticEffectsToUpdate.insert(effectIdx);
-            else if (!functionId && effect.function)
-                staticEffectsToUpdate.erase(effectIdx);
-
-            effect.Set(functionId, param, limit, auxilliary);
+            staticEffects.Set(GrowStaticEffect(effectIdx), functionId, param, limit, auxilliary);
+            ScheduleExpiry();
         }
 
         void SetStaticArousalValue(int32_t effectIdx, float value)
         {
-            ArousalEffectData& effect = GetStaticArousalEffect(effectIdx);
+            float& effectValue = staticEffects.Value(GrowStaticEffect(effectIdx));
 
-            float diff = value - effect.value;
-            effect.value = value;
-            if (!staticEffectGroups[effectIdx])
+            float diff = value - effectValue;
+            effectValue = value;
+            if (!staticEffects.IsGrouped(effectIdx))
                 arousal += diff;
+            ScheduleExpiry();
         }
 
         float ModStaticArousalValue(int32_t effectIdx, float diff, float limit)
         {
-            ArousalEffectData& effect = GetStaticArousalEffect(effectIdx);
+            float& effectValue = staticEffects.Value(GrowStaticEffect(effectIdx));
 
-            float value = effect.value + diff;
+            float value = effectValue + diff;
             float actualDiff = diff;
             if ((diff < 0 && limit > value) || (diff > 0 && limit < value))
             {
                 value = limit;
                 actualDiff = limit - value;
             }
-            effect.value = value;
-            if (!staticEffectGroups[effectIdx])
+            effectValue = value;
+            if (!staticEffects.IsGrouped(effectIdx))
                 arousal += actualDiff;
+            ScheduleExpiry();
             return actualDiff;
         }
 
-        bool CalculateArousalEffect(ArousalEffectData& effect, float timeDiff, RE::Actor* who)
+        bool CalculateArousalEffect(ArousalEffectData& effect, float timeDiff, uint32_t formId) const
         {
-            enum class LimitCheck
-            {
-                None,
-                UpperBound,
-                LowerBound
-            };
-            bool isDone = true;
-            LimitCheck checkLimit = LimitCheck::None;
-            float value;
-            switch (effect.function)
-            {
-            case 1:
-                value = effect.value * std::pow(0.5f, timeDiff / effect.param);
-                checkLimit = effect.param * effect.value < 0.f ? LimitCheck::UpperBound : LimitCheck::LowerBound;
-                break;
-            case 2:
-                value = effect.value + timeDiff * effect.param;
-                checkLimit = effect.param >= 0.f ? LimitCheck::UpperBound : LimitCheck::LowerBound;
-                break;
-            case 3:
-                value = (fastsin(float(who->formID % 7919) * 0.01f + lastUpdate * effect.param) + 1.f) * effect.limit;
-                break;
-            case 4:
-                value = lastUpdate < effect.param ? 0.f : effect.limit;
-                break;
-            default:
-                return true;
-            }
-
-            switch (checkLimit)
-            {
-            case LimitCheck::UpperBound:
-                if (effect.limit < value)
-                    value = effect.limit + GetEffectLimitOffset(effect.function);
-                else
-                    isDone = false;
-                break;
-            case LimitCheck::LowerBound:
-                if (effect.limit > value)
-                    value = effect.limit - GetEffectLimitOffset(effect.function);
-                else
-                    isDone = false;
-                break;
-            default: break;
-            }
+            return CalculateArousalEffect(effect.value, effect.function, effect.param, effect.limit, timeDiff, formId);
+        }
 
-            effect.value = value;
-            return isDone;
+        bool CalculateArousalEffect(float& effectValue, int32_t function, float param, float limit, float timeDiff, uint32_t formId) const
+        {
+            return EvaluateEffect(effectValue, function, param, limit, timeDiff, lastUpdate, formId);
         }
 
-        bool GroupEffects(RE::Actor* who, int32_t idx, int32_t idx2)
+        bool GroupEffects(uint32_t formId, int32_t idx, int32_t idx2)
         {
-            ArousalEffectData& first = GetStaticArousalEffect(idx);
-            ArousalEffectData& second = GetStaticArousalEffect(idx2);
-            ArousalEffectGroupPtr targetGrp = staticEffectGroups[idx];
-            ArousalEffectGroupPtr otherGrp = staticEffectGroups[idx2];
-            if (!targetGrp)
+            const float firstValue = staticEffects.Value(GrowStaticEffect(idx));
+            const float secondValue = staticEffects.Value(GrowStaticEffect(idx2));
+            uint16_t targetGrp = staticEffects.Group(idx);
+            uint16_t otherGrp = staticEffects.Group(idx2);
+            if (targetGrp == StaticEffectTable::kNoGroup)
                 targetGrp = otherGrp;
-            else if (otherGrp)
+            else if (otherGrp != StaticEffectTable::kNoGroup)
                 return targetGrp == otherGrp;
-            if (!targetGrp)
+            if (targetGrp == StaticEffectTable::kNoGroup)
             {
-                targetGrp = std::make_shared<ArousalEffectGroup>();
-                groupsToUpdate.push_back(targetGrp);
+                if (groups.size() >= StaticEffectTable::kNoGroup)
+                    throw std::length_error("Too many effect groups");
+                targetGrp = static_cast<uint16_t>(groups.size());
+                groups.emplace_back();
             }
 
-            if (!staticEffectGroups[idx])
+            ArousalEffectGroup& group = groups[targetGrp];
+            if (!staticEffects.IsGrouped(idx))
             {
-                staticEffectGroups[idx] = targetGrp;
-                targetGrp->staticEffectIds.push_back(idx);
-                staticEffectsToUpdate.erase(idx);
-                arousal -= first.value;
+                staticEffects.SetGroup(idx, targetGrp);
+                group.staticEffectIds.push_back(idx);
+                arousal -= firstValue;
             }
-            if (!staticEffectGroups[idx2])
+            if (!staticEffects.IsGrouped(idx2))
             {
-                staticEffectGroups[idx2] = targetGrp;
-                targetGrp->staticEffectIds.push_back(idx2);
-                staticEffectsToUpdate.erase(idx2);
-                arousal -= second.value;
+                staticEffects.SetGroup(idx2, targetGrp);
+                group.staticEffectIds.push_back(idx2);
+                arousal -= secondValue;
             }
 
-            UpdateGroup(*targetGrp, 0.f, who);
+            UpdateGroup(group, 0.f, formId);
+            ScheduleExpiry();
             return true;
         }
 
         void RemoveEffectGroup(int32_t idx)
         {
-            ArousalEffectGroupPtr group = staticEffectGroups[idx];
-            auto itr = std::find(groupsToUpdate.begin(), groupsToUpdate.end(), group);
-            if (itr == groupsToUpdate.end())
+            const uint32_t effectIdx = CheckStaticEffectIndex(idx);
+            const uint16_t groupIdx = effectIdx < staticEffects.Size() ? staticEffects.Group(effectIdx) : StaticEffectTable::kNoGroup;
+            if (groupIdx == StaticEffectTable::kNoGroup)
                 throw std::logic_error("Error while removing group: group does not exist!");
-            groupsToUpdate.erase(itr);
-            arousal -= group->value;
-            for (uint32_t id : group->staticEffectIds)
+
+            ArousalEffectGroup& group = groups[groupIdx];
+            arousal -= group.value;
+            for (uint32_t id : group.staticEffectIds)
             {
-                ArousalEffectData& eff = GetStaticArousalEffect(id);
-                staticEffectGroups[id] = nullptr;
-                arousal += eff.value;
-                if (eff.function)
-                    staticEffectsToUpdate.insert(id);
+                staticEffects.SetGroup(id, StaticEffectTable::kNoGroup);
+                arousal += staticEffects.Value(id);
             }
+
+            // Move the last group into the freed slot
+            if (groupIdx != groups.size() - 1)
+            {
+                group = std::move(groups.back());
+                for (uint32_t id : group.staticEffectIds)
+                    staticEffects.SetGroup(id, groupIdx);
+            }
+            groups.pop_back();
+            ScheduleExpiry();
         }
 
-        void UpdateSingleActorArousal(RE::Actor* who, float GameDaysPassed)
+        void UpdateSingleActorArousal(uint32_t formId, float GameDaysPassed)
         {
             if (!lastUpdate)
-            {
-                std::random_device rd;
-                std::default_random_engine gen{ rd() };
-                std::normal_distribution<> d{ 0.5, 2.0 };
-                float randomTimeDiff = std::abs(float(d(gen)));
-                lastUpdate = GameDaysPassed - randomTimeDiff;
-            }
+                lastUpdate = GameDaysPassed - GetInitialUpdateJitter(formId);
 
             float diff = GameDaysPassed - lastUpdate;
             lastUpdate = GameDaysPassed;
 
-            for (auto group : groupsToUpdate)
-                UpdateGroup(*group, diff, who);
+            for (auto& group : groups)
+                UpdateGroup(group, diff, formId);
 
-            for (auto itr = staticEffectsToUpdate.begin(); itr != staticEffectsToUpdate.end();)
-            {
-                if (staticEffectGroups[*itr])
-                    ++itr;
-                else
-                {
-                    ArousalEffectData& effect = staticEffects[*itr];
-                    if (UpdateArousalEffect(effect, diff, who))
-                    {
-                        effect.function = 0;
-                        itr = staticEffectsToUpdate.erase(itr);
-                    }
-                    else
-                        ++itr;
-                }
-            }
+            UpdateStaticEffects(diff, formId);
 
-            for (auto itr = dynamicEffectsToUpdate.begin(); itr != dynamicEffectsToUpdate.end();)
+            // Backwards, so effects moved into a removed position were already updated
+            for (uint32_t position = dynamicEffects.Size(); position-- > 0;)
             {
-                ArousalEffectData& effect = dynamicEffects[*itr];
-                if (UpdateArousalEffect(effect, diff, who))
+                auto& entry = dynamicEffects.At(position);
+                if (entry.effect.function && UpdateArousalEffect(entry.effect, diff, formId))
                 {
-                    effect.function = 0;
-                    RemoveDynamicEffectIfNeeded(*itr, effect);
-                    itr = dynamicEffectsToUpdate.erase(itr);
+                    entry.effect.function = 0;
+                    RemoveDynamicEffectIfNeeded(entry.name, entry.effect);
                 }
-                else
-                    ++itr;
             }
+            ScheduleExpiry();
         }
 
         float GetArousal() const { return arousal; }
         float GetLastUpdate() const { return lastUpdate; }
 
+        // For constant actors, brings lastUpdate forward to time like an update would
+        void SkipIdleTime(float time)
+        {
+            if (lastUpdate && time > lastUpdate)
+            {
+                lastUpdate = time;
+                ScheduleExpiry();
+            }
+        }
+
+        // Nothing changes with time, an update only moves lastUpdate
+        bool IsConstant() const
+        {
+            return groups.empty() && !staticEffects.AnyActive() &&
+                std::none_of(dynamicEffects.begin(), dynamicEffects.end(), [](auto const& entry) { return entry.effect.function != 0; });
+        }
+
+        ArousalSummary GetSummary() const
+        {
+            ArousalSummary summary;
+            summary.arousal = arousal;
+            summary.lastUpdate = lastUpdate;
+            summary.nextExpiry = nextExpiry;
+            summary.constant = IsConstant();
+            summary.dynamicEffectCount = GetDynamicEffectCount();
+            summary.activeStaticEffects = staticEffects.UpdatedBits(0);
+            return summary;
+        }
+        float GetNextExpiry() const { return nextExpiry; }
+
     private:
+        // Earliest game time at which an updated effect reaches its limit and has to be retired by an update.
+        // Grouped effects are never retired, their projection stays valid.
+        void ScheduleExpiry()
+        {
+            float timeToLimit = std::numeric_limits<float>::infinity();
+            staticEffects.ForEachUpdated([&](uint32_t idx) {
+                timeToLimit = std::min(timeToLimit, GetTimeToLimit(staticEffects.Function(idx), staticEffects.Value(idx), staticEffects.Param(idx), staticEffects.Limit(idx)));
+            });
+            for (auto const& entry : dynamicEffects)
+            {
+                if (entry.effect.function)
+                    timeToLimit = std::min(timeToLimit, GetTimeToLimit(entry.effect.function, entry.effect.value, entry.effect.param, entry.effect.limit));
+            }
+            nextExpiry = lastUpdate + timeToLimit;
+        }
+
+        float ProjectEffect(float value, int32_t function, float param, float limit, uint32_t formId, float time) const
+        {
+            if (time > lastUpdate)
+                EvaluateEffect(value, function, param, limit, time - lastUpdate, time, formId);
+            return value;
+        }
+
+        float ProjectEffect(ArousalEffectData const& effect, uint32_t formId, float time) const
+        {
+            return ProjectEffect(effect.value, effect.function, effect.param, effect.limit, formId, time);
+        }
+
+        float ProjectGroup(ArousalEffectGroup const& group, uint32_t formId, float time) const
+        {
+            if (time <= lastUpdate)
+                return group.value;
+            float value = 1.f;
+            for (uint32_t id : group.staticEffectIds)
+                value *= ProjectEffect(staticEffects.Value(id), staticEffects.Function(id), staticEffects.Param(id), staticEffects.Limit(id), formId, time);
+            return value;
+        }
+
         void UpdateGroupFactor(ArousalEffectGroup& group, float oldFactor, float newFactor)
         {
             float value = group.value / oldFactor * newFactor;
@@ -453,25 +751,233 @@ namespace slaModules
             group.value = value;
         }
 
-        void UpdateGroup(ArousalEffectGroup& group, float timeDiff, RE::Actor* who)
+        void UpdateGroup(ArousalEffectGroup& group, float timeDiff, uint32_t formId)
         {
             float value = 1.f;
             for (uint32_t id : group.staticEffectIds)
             {
-                ArousalEffectData& eff = GetStaticArousalEffect(id);
-                CalculateArousalEffect(eff, timeDiff, who);
-                value *= eff.value;
+                CalculateStaticEffect(id, timeDiff, formId);
+                value *= staticEffects.Value(id);
             }
             float diff = value - group.value;
             arousal += diff;
             group.value = value;
         }
 
-        // Should only be called for non-grouped effects
-        bool UpdateArousalEffect(ArousalEffectData& effect, float timeDiff, RE::Actor* who)
+        bool CalculateStaticEffect(uint32_t idx, float timeDiff, uint32_t formId)
+        {
+            return CalculateArousalEffect(staticEffects.Value(idx), staticEffects.Function(idx), staticEffects.Param(idx), staticEffects.Limit(idx), timeDiff, formId);
+        }
+
+        // Evaluates the active, ungrouped static effects bucket by bucket, each with the kernel of its kind
+        void UpdateStaticEffects(float timeDiff, uint32_t formId)
+        {
+            const EffectContext context{ timeDiff, lastUpdate, GetSinePhase(formId) };
+            EffectBatch batch;
+            for (uint32_t kind = 0; kind < kEffectKindCount; ++kind)
+            {
+                staticEffects.ForEachUpdated(kind, [&](uint32_t idx) {
+                    batch.values[batch.count] = staticEffects.Value(idx);
+                    batch.params[batch.count] = staticEffects.Param(idx);
+                    batch.limits[batch.count] = staticEffects.Limit(idx);
+                    batch.functions[batch.count] = staticEffects.Function(idx);
+                    batch.indices[batch.count] = idx;
+                    if (++batch.count == kEffectBatchSize)
+                        FlushStaticEffects(kind, batch, context);
+                });
+                FlushStaticEffects(kind, batch, context);
+            }
+        }
+
+        void FlushStaticEffects(uint32_t kind, EffectBatch& batch, EffectContext const& context)
+        {
+            if (!batch.count)
+                return;
+            batch.PadTail();
+            float previous[kEffectBatchSize];
+            std::copy_n(batch.values, batch.count, previous);
+            const uint64_t done = effectKernels->Get(kind)(batch, context);
+            for (uint32_t i = 0; i < batch.count; ++i)
+            {
+                const uint32_t idx = batch.indices[i];
+                staticEffects.Value(idx) = batch.values[i];
+                arousal += batch.values[i] - previous[i];
+                if (done & (1ull << i))
+                    staticEffects.Deactivate(idx);
+            }
+            batch.count = 0;
+        }
+
+        // Versions 1 and 2, fixed size fields and every static effect of the actor
+        void ReadLegacy(RecordReader& reader, std::vector<uint32_t> const* symbolMap)
+        {
+            arousal = reader.Read<float>();
+            lastUpdate = reader.Read<float>();
+            uint32_t count = reader.Read<uint32_t>();
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                const auto effect = reader.Read<ArousalEffectData>();
+                if (effect.IsDefault())
+                    continue;
+                ReserveStaticEffect(j);
+                staticEffects.Put(j, effect);
+            }
+
+            count = reader.Read<uint8_t>();
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                ArousalEffectGroup& grp = AddLoadedGroup();
+                uint32_t grpEntiryCount = reader.Read<uint32_t>();
+                for (uint32_t k = 0; k < grpEntiryCount; ++k)
+                    AddLoadedGroupMember(grp, reader.Read<uint32_t>());
+                SetLoadedGroupValue(grp, reader.Read<float>());
+            }
+            // Active static effects follow from their function, the stored list is redundant
+            count = reader.Read<uint32_t>();
+            for (uint32_t j = 0; j < count; ++j)
+                reader.Read<uint32_t>();
+            count = reader.Read<uint32_t>();
+            for (uint32_t j = 0; j < count; ++j) {
+                uint32_t name = ReadSymbol(reader, symbolMap);
+                dynamicEffects.GetOrCreate(name) = reader.Read<ArousalEffectData>();
+            }
+            // Like static effects, the dynamic effects to update follow from their function
+            count = reader.Read<uint32_t>();
+            for (uint32_t j = 0; j < count; ++j)
+                ReadSymbol(reader, symbolMap);
+        }
+
+        void ReadCompact(RecordReader& reader, std::vector<uint32_t> const& symbolMap)
+        {
+            arousal = reader.Read<float>();
+            lastUpdate = reader.Read<float>();
+
+            uint32_t count = reader.ReadVarint();
+            if (count > reader.Remaining() * 8)
+                throw std::length_error("savegame data ended unexpected");
+            std::vector<uint8_t> present((count + 7) / 8);
+            for (uint8_t& bits : present)
+                bits = reader.Read<uint8_t>();
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                if ((present[j / 8] >> (j % 8)) & 1)
+                {
+                    ReserveStaticEffect(j);
+                    staticEffects.Put(j, ReadCompactEffect(reader));
+                }
+            }
+
+            count = reader.ReadVarint();
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                ArousalEffectGroup& grp = AddLoadedGroup();
+                const uint32_t memberCount = reader.ReadVarint();
+                for (uint32_t k = 0; k < memberCount; ++k)
+                    AddLoadedGroupMember(grp, reader.ReadVarint());
+                SetLoadedGroupValue(grp, reader.Read<float>());
+            }
+
+            count = reader.ReadVarint();
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                uint32_t name = MapSymbol(reader.ReadVarint(), symbolMap);
+                dynamicEffects.GetOrCreate(name) = ReadCompactEffect(reader);
+            }
+        }
+
+        ArousalEffectGroup& AddLoadedGroup()
+        {
+            if (groups.size() >= StaticEffectTable::kNoGroup)
+                throw std::length_error("Too many effect groups");
+            return groups.emplace_back();
+        }
+
+        // The registry is loaded before the actors, a member it does not know comes from a corrupt record
+        void AddLoadedGroupMember(ArousalEffectGroup& group, uint32_t effectIdx)
+        {
+            if (effectIdx >= staticEffectRegistry.Size())
+                throw std::out_of_range("Invalid group member");
+            ReserveStaticEffect(effectIdx);
+            group.staticEffectIds.emplace_back(effectIdx);
+            staticEffects.SetGroup(effectIdx, static_cast<uint16_t>(&group - groups.data()));
+        }
+
+        void SetLoadedGroupValue(ArousalEffectGroup& group, float value)
+        {
+            group.value = value;
+            if (std::abs(group.value) > 10000.f)
+            {
+                logger::info("Possibly corrupted data reseting to zero");
+                group.value = 0.f;
+            }
+        }
+
+        // Group membership is stored with the groups, it does not keep an effect from being default
+        bool IsDefaultStaticEffect(uint32_t idx) const
+        {
+            return staticEffects.Get(idx).IsDefault();
+        }
+
+        static void WriteCompactEffect(RecordWriter& writer, ArousalEffectData const& effect)
+        {
+            writer.Write(effect.value);
+            writer.WriteSignedVarint(effect.function);
+            writer.Write(effect.param);
+            writer.Write(effect.limit);
+            writer.WriteSignedVarint(effect.intAux);
+        }
+
+        static ArousalEffectData ReadCompactEffect(RecordReader& reader)
+        {
+            ArousalEffectData effect;
+            effect.value = reader.Read<float>();
+            effect.function = reader.ReadSignedVarint();
+            effect.param = reader.Read<float>();
+            effect.limit = reader.Read<float>();
+            effect.intAux = reader.ReadSignedVarint();
+            return effect;
+        }
+
+        static uint32_t ReadSymbol(RecordReader& reader, std::vector<uint32_t> const* symbolMap)
+        {
+            if (!symbolMap)
+                return symbols.Intern(reader.ReadString());
+            return MapSymbol(reader.Read<uint32_t>(), *symbolMap);
+        }
+
+        static uint32_t MapSymbol(uint32_t id, std::vector<uint32_t> const& symbolMap)
+        {
+            if (id >= symbolMap.size())
+                throw std::out_of_range("Invalid symbol id");
+            return symbolMap[id];
+        }
+
+        // Valid indices are those of the registry, the actor only stores the effects up to the highest one it touched
+        uint32_t CheckStaticEffectIndex(int32_t effectIdx) const
+        {
+            if (effectIdx < 0 || static_cast<uint32_t>(effectIdx) >= std::max(staticEffectRegistry.Size(), staticEffects.Size()))
+                throw std::invalid_argument("Invalid static effect index");
+            return static_cast<uint32_t>(effectIdx);
+        }
+
+        uint32_t GrowStaticEffect(int32_t effectIdx)
+        {
+            const uint32_t idx = CheckStaticEffectIndex(effectIdx);
+            ReserveStaticEffect(idx);
+            return idx;
+        }
+
+        void ReserveStaticEffect(uint32_t idx)
+        {
+            if (idx < staticEffects.Size())
+                return;
+            staticEffects.Resize(idx + 1);
+        }
+
+        bool UpdateArousalEffect(ArousalEffectData& effect, float timeDiff, uint32_t formId)
         {
             float oldValue = effect.value;
-            bool isDone = CalculateArousalEffect(effect, timeDiff, who);
+            bool isDone = CalculateArousalEffect(effect, timeDiff, formId);
             float diff = effect.value - oldValue;
             arousal += diff;
             return isDone;
@@ -480,14 +986,12 @@ namespace slaModules
         ArousalData& operator=(const ArousalData&) = delete;
         ArousalData(const ArousalData&) = delete;
 
-        std::unordered_set<int32_t> staticEffectsToUpdate;
-        std::vector<ArousalEffectData> staticEffects;
-        std::vector<ArousalEffectGroupPtr> staticEffectGroups;
-        std::unordered_set<std::string> dynamicEffectsToUpdate;
-        std::unordered_map<std::string, ArousalEffectData> dynamicEffects;
-        std::vector<ArousalEffectGroupPtr> groupsToUpdate;
+        StaticEffectTable staticEffects;
+        DynamicEffectList dynamicEffects;
+        std::vector<ArousalEffectGroup> groups;
         float arousal;
         float lastUpdate;
+        float nextExpiry;
         float lockedArousal;
     };
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "ActorStore.h"
+
+namespace slaModules
+{
+    // Every published actor ordered by arousal, for natives that ask for the most aroused actors or
+    // how many are above a threshold without scripts reading and sorting every actor.
+    //
+    // Split into the same shards as the actors, each a vector sorted by arousal and then formId behind
+    // its own lock. Parallel updates only ever touch their own shard, and a query holds each lock just
+    // long enough to search that shard. Arousal usually changes by little per update, so moving an
+    // actor searches for its old position and walks from there to the new one. Larger jumps and loading
+    // a save do not walk, see Update and FinishLoad.
+    class ArousalRanking
+    {
+    public:
+        static constexpr uint32_t kShardCount = ShardedActorStore::kShardCount;
+        // Moves over more entries than this erase and insert again, which is a memmove instead
+        static constexpr uint32_t kMaxWalk = 16;
+
+        // Moves the actor from previous to arousal, or adds it if it was not ranked
+        void Update(uint32_t formId, bool ranked, float previous, float arousal)
+        {
+            const Entry entry{ Rank(arousal), formId };
+            auto& shard = shards[ShardedActorStore::ShardIndex(formId)];
+            std::lock_guard<std::mutex> guard(shard.lock);
+            if (shard.loading)
+                return;
+            auto& entries = shard.entries;
+            auto pos = ranked ? Find(entries, { Rank(previous), formId }) : entries.end();
+            if (pos == entries.end())
+            {
+                entries.insert(LowerBound(entries, entry), entry);
+                return;
+            }
+            // The entries passed on the way shift by one into the gap, which keeps the vector sorted
+            // around it if the walk gives up
+            uint32_t steps = 0;
+            while (pos + 1 != entries.end() && pos[1] < entry && steps++ < kMaxWalk)
+            {
+                pos[0] = pos[1];
+                ++pos;
+            }
+            while (pos != entries.begin() && entry < pos[-1] && steps++ < kMaxWalk)
+            {
+                pos[0] = pos[-1];
+                --pos;
+            }
+            if (steps > kMaxWalk)
+            {
+                entries.erase(pos);
+                entries.insert(LowerBound(entries, entry), entry);
+                return;
+            }
+            *pos = entry;
+        }
+
+        void Remove(uint32_t formId, float arousal)
+        {
+            auto& shard = shards[ShardedActorStore::ShardIndex(formId)];
+            std::lock_guard<std::mutex> guard(shard.lock);
+            if (shard.loading)
+                return;
+            auto itr = Find(shard.entries, { Rank(arousal), formId });
+            if (itr != shard.entries.end())
+                shard.entries.erase(itr);
+        }
+
+        void Clear()
+        {
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.entries.clear();
+            }
+        }
+
+        // Loading publishes every actor of the save, inserting them one by one would shift each shard
+        // over and over. Empties the ranking and ignores changes until FinishLoad.
+        void StartLoad()
+        {
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.entries.clear();
+                shard.loading = true;
+            }
+        }
+
+        // Ranks the actors as published, formId and arousal, with one sort per shard. Nothing may
+        // publish meanwhile, the caller holds every actor shard.
+        void FinishLoad(std::vector<std::pair<uint32_t, float>> const& actors)
+        {
+            std::array<std::vector<Entry>, kShardCount> loaded;
+            for (auto const& [formId, arousal] : actors)
+                loaded[ShardedActorStore::ShardIndex(formId)].push_back({ Rank(arousal), formId });
+            for (uint32_t i = 0; i < kShardCount; ++i)
+            {
+                std::sort(loaded[i].begin(), loaded[i].end());
+                std::lock_guard<std::mutex> guard(shards[i].lock);
+                shards[i].entries = std::move(loaded[i]);
+                shards[i].loading = false;
+            }
+        }
+
+        // Up to count actors with the highest arousal, highest first. Ties go to the higher formId.
+        std::vector<uint32_t> GetTop(uint32_t count)
+        {
+            std::vector<Entry> found;
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                const auto& entries = shard.entries;
+                found.insert(found.end(), entries.end() - std::min<size_t>(count, entries.size()), entries.end());
+            }
+            const size_t kept = std::min<size_t>(count, found.size());
+            std::partial_sort(found.begin(), found.begin() + kept, found.end(), std::greater<Entry>());
+            found.resize(kept);
+            return FormIds(found);
+        }
+
+        // Actors with an arousal of at least minArousal, a NaN bound matches none
+        uint32_t CountAbove(float minArousal)
+        {
+            uint32_t total = 0;
+            if (std::isnan(minArousal))
+                return total;
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                const auto& entries = shard.entries;
+                total += static_cast<uint32_t>(entries.end() - LowerBound(entries, minArousal));
+            }
+            return total;
+        }
+
+        // Actors with an arousal within [minArousal, maxArousal], highest first
+        std::vector<uint32_t> GetInRange(float minArousal, float maxArousal)
+        {
+            std::vector<Entry> found;
+            if (std::isnan(minArousal) || std::isnan(maxArousal))
+                return {};
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                const auto& entries = shard.entries;
+                auto end = UpperBound(entries, maxArousal);
+                auto begin = std::min(LowerBound(entries, minArousal), end);
+                found.insert(found.end(), begin, end);
+            }
+            std::sort(found.begin(), found.end(), std::greater<Entry>());
+            return FormIds(found);
+        }
+
+        uint32_t Size()
+        {
+            uint32_t total = 0;
+            for (auto& shard : shards)
+            {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                total += static_cast<uint32_t>(shard.entries.size());
+            }
+            return total;
+        }
+
+    private:
+        struct Entry
+        {
+            float arousal;
+            uint32_t formId;
+
+            // Without branches, so the searches below compile to conditional moves
+            bool operator<(Entry const& other) const { return (arousal < other.arousal) | ((arousal == other.arousal) & (formId < other.formId)); }
+            bool operator>(Entry const& other) const { return other < *this; }
+        };
+
+        struct alignas(64) Shard
+        {
+            std::mutex lock;
+            std::vector<Entry> entries;
+            bool loading = false;
+        };
+
+        // NaN would break the order, it ranks below everything instead
+        static float Rank(float arousal)
+        {
+            return arousal == arousal ? arousal : -std::numeric_limits<float>::infinity();
+        }
+
+        // std::lower_bound, but the outcome of each comparison only picks the next half instead of
+        // being a branch the predictor gets wrong every other step
+        static std::vector<Entry>::iterator LowerBound(std::vector<Entry>& entries, Entry const& entry)
+        {
+            if (entries.empty())
+                return entries.end();
+            auto first = entries.begin();
+            size_t count = entries.size();
+            while (count > 1)
+            {
+                const size_t half = count / 2;
+                first = first[half] < entry ? first + half : first;
+                count -= half;
+            }
+            return first + (*first < entry);
+        }
+
+        static std::vector<Entry>::iterator Find(std::vector<Entry>& entries, Entry const& entry)
+        {
+            auto itr = LowerBound(entries, entry);
+            return itr != entries.end() && !(entry < *itr) ? itr : entries.end();
+        }
+
+        static std::vector<Entry>::const_iterator LowerBound(std::vector<Entry> const& entries, float arousal)
+        {
+            return std::partition_point(entries.begin(), entries.end(), [arousal](Entry const& entry) { return entry.arousal < arousal; });
+        }
+
+        static std::vector<Entry>::const_iterator UpperBound(std::vector<Entry> const& entries, float arousal)
+        {
+            return std::partition_point(entries.begin(), entries.end(), [arousal](Entry const& entry) { return entry.arousal <= arousal; });
+        }
+
+        static std::vector<uint32_t> FormIds(std::vector<Entry> const& entries)
+        {
+            std::vector<uint32_t> result;
+            result.reserve(entries.size());
+            for (auto const& entry : entries)
+                result.push_back(entry.formId);
+            return result;
+        }
+
+        std::array<Shard, kShardCount> shards;
+    };
+}
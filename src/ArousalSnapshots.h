@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Arousal.h"
+
+namespace slaModules
+{
+    // ArousalSummary of every actor, published by the writers and read without locks.
+    //
+    // Each actor has an entry guarded by a sequence counter (seqlock): the writer makes the counter
+    // odd, stores the words and makes it even again, a reader retries until it saw the same even
+    // counter before and after copying the words. There has to be at most one writer per actor at
+    // a time, which the callers already need for the ArousalData itself.
+    //
+    // Entries never move or get freed while the table lives. The formId index is an open addressing
+    // table that is replaced by a larger copy when it fills up. Readers may still be probing the
+    // old one, so replaced tables are kept, together they are smaller than the current one.
+    class ArousalSnapshots
+    {
+    public:
+        ArousalSnapshots() { Grow(kMinTableSize); }
+        ArousalSnapshots(const ArousalSnapshots&) = delete;
+        ArousalSnapshots& operator=(const ArousalSnapshots&) = delete;
+
+        // Lock free. Returns false for actors without a published summary.
+        bool Read(uint32_t formId, ArousalSummary& summary) const
+        {
+            Entry const* entry = Find(formId);
+            if (!entry)
+                return false;
+
+            Words words;
+            for (;;)
+            {
+                const uint32_t before = entry->sequence.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;
+                // Acquire keeps the second counter load behind the words, without a fence ThreadSanitizer can not follow
+                for (size_t i = 0; i < kWordCount; ++i)
+                    words[i] = entry->words[i].load(std::memory_order_acquire);
+                if (entry->sequence.load(std::memory_order_relaxed) == before)
+                    break;
+            }
+            if (!words[kPresentWord])
+                return false;
+            Unpack(words, summary);
+            return true;
+        }
+
+        void Publish(uint32_t formId, ArousalSummary const& summary)
+        {
+            Words words;
+            Pack(summary, words);
+            Store(GetOrCreate(formId), words);
+        }
+
+        // The actor reads as absent until it is published again
+        void Withdraw(uint32_t formId)
+        {
+            if (Entry* entry = Find(formId))
+                Store(*entry, Words{});
+        }
+
+        // Withdraws every actor. Entries stay allocated, actors come back with the next load. Like
+        // Publish it must be the only writer of every entry, RevertData holds all actor shards.
+        void Clear()
+        {
+            std::lock_guard<std::mutex> guard(writeLock);
+            for (auto& entry : entries)
+                Store(entry, Words{});
+        }
+
+    private:
+        static constexpr size_t kMinTableSize = 1024;
+        static constexpr size_t kWordCount = 8;
+        static constexpr size_t kPresentWord = kWordCount - 1;
+
+        using Words = std::array<uint32_t, kWordCount>;
+
+        struct Entry
+        {
+            std::atomic<uint32_t> sequence{ 0 };
+            std::array<std::atomic<uint32_t>, kWordCount> words{};
+        };
+
+        // formId 0 marks a free position, the null actor never gets published
+        struct Table
+        {
+            explicit Table(size_t size) : mask(size - 1), formIds(size), entries(size) {}
+
+            size_t mask;
+            std::vector<std::atomic<uint32_t>> formIds;
+            std::vector<std::atomic<Entry*>> entries;
+        };
+
+        static size_t Ideal(uint32_t formId, size_t mask)
+        {
+            const uint32_t hash = formId * 0x9E3779B1u;
+            return (hash ^ (hash >> 16)) & mask;
+        }
+
+        static uint32_t ToWord(float value)
+        {
+            uint32_t word;
+            std::memcpy(&word, &value, sizeof(word));
+            return word;
+        }
+
+        static float ToFloat(uint32_t word)
+        {
+            float value;
+            std::memcpy(&value, &word, sizeof(value));
+            return value;
+        }
+
+        static void Pack(ArousalSummary const& summary, Words& words)
+        {
+            words[0] = ToWord(summary.arousal);
+            words[1] = ToWord(summary.lastUpdate);
+            words[2] = ToWord(summary.nextExpiry);
+            words[3] = summary.constant;
+            words[4] = static_cast<uint32_t>(summary.dynamicEffectCount);
+            words[5] = static_cast<uint32_t>(summary.activeStaticEffects);
+            words[6] = static_cast<uint32_t>(summary.activeStaticEffects >> 32);
+            words[kPresentWord] = 1;
+        }
+
+        static void Unpack(Words const& words, ArousalSummary& summary)
+        {
+            summary.arousal = ToFloat(words[0]);
+            summary.lastUpdate = ToFloat(words[1]);
+            summary.nextExpiry = ToFloat(words[2]);
+            summary.constant = words[3] != 0;
+            summary.dynamicEffectCount = static_cast<int32_t>(words[4]);
+            summary.activeStaticEffects = words[5] | static_cast<uint64_t>(words[6]) << 32;
+        }
+
+        static void Store(Entry& entry, Words const& words)
+        {
+            const uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+            entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+            // Release keeps the odd counter ahead of every word
+            for (size_t i = 0; i < kWordCount; ++i)
+                entry.words[i].store(words[i], std::memory_order_release);
+            entry.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        Entry* Find(uint32_t formId) const
+        {
+            Table const* table = current.load(std::memory_order_acquire);
+            for (size_t pos = Ideal(formId, table->mask);; pos = (pos + 1) & table->mask)
+            {
+                const uint32_t found = table->formIds[pos].load(std::memory_order_acquire);
+                if (!found)
+                    return nullptr;
+                if (found == formId)
+                    return table->entries[pos].load(std::memory_order_relaxed);
+            }
+        }
+
+        Entry& GetOrCreate(uint32_t formId)
+        {
+            if (Entry* entry = Find(formId))
+                return *entry;
+
+            std::lock_guard<std::mutex> guard(writeLock);
+            if (Entry* entry = Find(formId))
+                return *entry;
+            Table* table = current.load(std::memory_order_relaxed);
+            if ((count + 1) * 2 > table->formIds.size())
+                table = Grow(table->formIds.size() * 2);
+            Entry& entry = entries.emplace_back();
+            Insert(*table, formId, &entry);
+            ++count;
+            return entry;
+        }
+
+        // The entry is stored before the formId, a reader that finds the formId also finds the entry
+        static void Insert(Table& table, uint32_t formId, Entry* entry)
+        {
+            size_t pos = Ideal(formId, table.mask);
+            while (table.formIds[pos].load(std::memory_order_relaxed))
+                pos = (pos + 1) & table.mask;
+            table.entries[pos].store(entry, std::memory_order_relaxed);
+            table.formIds[pos].store(formId, std::memory_order_release);
+        }
+
+        Table* Grow(size_t size)
+        {
+            auto table = std::make_unique<Table>(size);
+            if (Table const* old = current.load(std::memory_order_relaxed))
+            {
+                for (size_t pos = 0; pos < old->formIds.size(); ++pos)
+                {
+                    if (const uint32_t formId = old->formIds[pos].load(std::memory_order_relaxed))
+                        Insert(*table, formId, old->entries[pos].load(std::memory_order_relaxed));
+                }
+            }
+            current.store(table.get(), std::memory_order_release);
+            tables.push_back(std::move(table));
+            return tables.back().get();
+        }
+
+        std::atomic<Table*> current{ nullptr };
+        // Everything below is only touched under writeLock
+        std::mutex writeLock;
+        std::vector<std::unique_ptr<Table>> tables;
+        std::deque<Entry> entries;
+        size_t count = 0;
+    };
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "FastMath.h"
+
+namespace slaModules
+{
+    // Effect functions from kFirstCurveFunction on evaluate the curves mods register at runtime
+    constexpr int32_t kFirstCurveFunction = 100;
+    constexpr uint32_t kMaxEffectCurves = 256;
+
+    // Piecewise linear curve over one period. The points are resampled into kSegments equal segments
+    // when the curve is registered, evaluating it is two loads and a lerp however many points it has.
+    class EffectCurve
+    {
+    public:
+        static constexpr uint32_t kSegments = 256;
+        static constexpr uint32_t kMaxPoints = 128;
+
+        // Constant zero, what effects of unregistered curves evaluate to
+        EffectCurve() { samples.fill(0.f); }
+
+        // xs must rise from 0 to at most 1, the curve holds its first and last value outside of them
+        EffectCurve(std::vector<float> a_xs, std::vector<float> a_ys) : xs(std::move(a_xs)), ys(std::move(a_ys))
+        {
+            if (xs.empty() || xs.size() != ys.size() || xs.size() > kMaxPoints)
+                throw std::invalid_argument("Curve needs between 1 and 128 points with an x and y each");
+            for (size_t i = 0; i < xs.size(); ++i)
+            {
+                if (!std::isfinite(xs[i]) || !std::isfinite(ys[i]) || xs[i] < 0.f || xs[i] > 1.f || (i && xs[i] <= xs[i - 1]))
+                    throw std::invalid_argument("Curve points must be finite with x rising within [0, 1]");
+            }
+
+            size_t next = 0;
+            for (uint32_t i = 0; i <= kSegments; ++i)
+            {
+                const float x = float(i) / kSegments;
+                while (next < xs.size() && xs[next] < x)
+                    ++next;
+                if (next == 0)
+                    samples[i] = ys.front();
+                else if (next == xs.size())
+                    samples[i] = ys.back();
+                else
+                    samples[i] = ys[next - 1] + (ys[next] - ys[next - 1]) * (x - xs[next - 1]) / (xs[next] - xs[next - 1]);
+            }
+        }
+
+        // Value at the fractional part of position
+        float Sample(float position) const
+        {
+            const float scaled = (position - FastMath::RoundNearest(position - 0.5f)) * kSegments;
+            // NaN and rounding past either end land on a valid segment
+            const float segment = std::max(0.f, std::min(FastMath::RoundNearest(scaled - 0.5f), float(kSegments - 1)));
+            const auto i = static_cast<uint32_t>(segment);
+            return samples[i] + (samples[i + 1] - samples[i]) * (scaled - segment);
+        }
+
+        std::vector<float> const& Xs() const { return xs; }
+        std::vector<float> const& Ys() const { return ys; }
+
+    private:
+        // The points as registered, saved so the curve exists before mods register it again
+        std::vector<float> xs;
+        std::vector<float> ys;
+        std::array<float, kSegments + 1> samples;
+    };
+
+    // Curves by name. Updates read them without the lock, so a curve is never changed once published:
+    // registering a name again publishes a new curve under the same function. Replaced and cleared
+    // curves are retired, ReclaimEffectCurves in Engine.h frees them once no update can still hold them.
+    class EffectCurveRegistry
+    {
+    public:
+        struct Entry
+        {
+            std::string name;
+            std::vector<float> xs;
+            std::vector<float> ys;
+        };
+
+        EffectCurveRegistry()
+        {
+            for (auto& curve : curves)
+                curve.store(&zero, std::memory_order_relaxed);
+        }
+
+        // Effect function of the curve, 0 if no curve has that name
+        int32_t Find(std::string_view name) const
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            auto itr = ids.find(name);
+            return itr != ids.end() ? kFirstCurveFunction + static_cast<int32_t>(itr->second) : 0;
+        }
+
+        // Adds or replaces the curve and returns its effect function. Mods register their curves again
+        // on every load, the same points keep the published curve.
+        int32_t Register(std::string_view name, std::vector<float> xs, std::vector<float> ys)
+        {
+            if (name.empty())
+                throw std::invalid_argument("Curve needs a name");
+            auto curve = std::make_unique<EffectCurve>(std::move(xs), std::move(ys));
+            std::unique_lock<std::shared_mutex> guard(lock);
+            auto itr = ids.find(name);
+            uint32_t id;
+            if (itr != ids.end())
+            {
+                id = itr->second;
+                if (owned[id]->Xs() == curve->Xs() && owned[id]->Ys() == curve->Ys())
+                    return kFirstCurveFunction + static_cast<int32_t>(id);
+            }
+            else
+            {
+                id = static_cast<uint32_t>(std::find(names.begin(), names.end(), std::string()) - names.begin());
+                if (id == kMaxEffectCurves)
+                    throw std::length_error("Too many effect curves");
+                if (id == names.size())
+                    names.emplace_back();
+                names[id] = name;
+                ids.emplace(names[id], id);
+            }
+            Publish(id, std::move(curve));
+            return kFirstCurveFunction + static_cast<int32_t>(id);
+        }
+
+        // Curve is below kMaxEffectCurves, ids nothing was registered for give the zero curve
+        EffectCurve const& Get(uint32_t curve) const { return *curves[curve].load(std::memory_order_acquire); }
+
+        // Indexed by curve, empty names and points for ids without a curve. Copies the points, a curve
+        // may be replaced and freed right after.
+        std::vector<Entry> GetEntries() const
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            std::vector<Entry> result;
+            for (uint32_t id = 0; id < names.size(); ++id)
+            {
+                if (owned[id])
+                    result.push_back({ names[id], owned[id]->Xs(), owned[id]->Ys() });
+                else
+                    result.push_back({ names[id], {}, {} });
+            }
+            return result;
+        }
+
+        // Loading puts every saved curve back under its id
+        void Assign(uint32_t id, std::string_view name, std::vector<float> xs, std::vector<float> ys)
+        {
+            if (id >= kMaxEffectCurves)
+                throw std::out_of_range("Invalid effect curve id");
+            auto curve = std::make_unique<EffectCurve>(std::move(xs), std::move(ys));
+            std::unique_lock<std::shared_mutex> guard(lock);
+            if (name.empty() || ids.count(name) || (id < names.size() && !names[id].empty()))
+                return;
+            if (id >= names.size())
+                names.resize(id + 1);
+            names[id] = name;
+            ids.emplace(names[id], id);
+            Publish(id, std::move(curve));
+        }
+
+        void Clear()
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            for (uint32_t id = 0; id < kMaxEffectCurves; ++id)
+            {
+                curves[id].store(&zero, std::memory_order_release);
+                if (owned[id])
+                    retired.push_back(std::move(owned[id]));
+            }
+            ids.clear();
+            names.clear();
+        }
+
+        // Curves replaced or cleared since the last call. Updates that started before may still be
+        // evaluating them, the caller frees them once those are done.
+        std::vector<std::unique_ptr<EffectCurve>> TakeRetired()
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            std::vector<std::unique_ptr<EffectCurve>> result;
+            result.swap(retired);
+            return result;
+        }
+
+    private:
+        void Publish(uint32_t id, std::unique_ptr<EffectCurve> curve)
+        {
+            curves[id].store(curve.get(), std::memory_order_release);
+            if (owned[id])
+                retired.push_back(std::move(owned[id]));
+            owned[id] = std::move(curve);
+        }
+
+        mutable std::shared_mutex lock;
+        std::array<std::atomic<EffectCurve const*>, kMaxEffectCurves> curves;
+        // deque keeps the strings in place, the views in ids point into them
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::array<std::unique_ptr<EffectCurve>, kMaxEffectCurves> owned;
+        std::vector<std::unique_ptr<EffectCurve>> retired;
+        const EffectCurve zero;
+    };
+
+    EffectCurveRegistry effectCurves;
+}
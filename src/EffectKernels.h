@@ -0,0 +1,599 @@
+#pragma once
+
+#include "EffectCurves.h"
+#include "FastMath.h"
+#include "Utils.h"
+
+#if defined(_MSC_VER)
+#define SLAM_TARGET_AVX2
+#else
+#define SLAM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace slaModules
+{
+    // Added to the limit of a decay when it is set and taken off again once reached, so the value ends
+    // on the requested limit instead of approaching it forever
+    constexpr float kDecayLimitOffset = 0.5f;
+    constexpr float kLinearLimitOffset = 0.f;
+
+    // Reference evaluation of the effect functions, one effect at a time.
+    // Decay and linear effects return true once they reached their limit, sine and step effects are always done.
+
+    bool EvaluateDecay(float& value, float param, float limit, float timeDiff)
+    {
+        float result = value * FastMath::Exp2(-(timeDiff / param));
+        if (param * value < 0.f)
+        {
+            if (limit < result)
+            {
+                value = limit + kDecayLimitOffset;
+                return true;
+            }
+        }
+        else if (limit > result)
+        {
+            value = limit - kDecayLimitOffset;
+            return true;
+        }
+        value = result;
+        return false;
+    }
+
+    bool EvaluateLinear(float& value, float param, float limit, float timeDiff)
+    {
+        float result = value + timeDiff * param;
+        if (param >= 0.f)
+        {
+            if (limit < result)
+            {
+                value = limit + kLinearLimitOffset;
+                return true;
+            }
+        }
+        else if (limit > result)
+        {
+            value = limit - kLinearLimitOffset;
+            return true;
+        }
+        value = result;
+        return false;
+    }
+
+    float GetSinePhase(uint32_t formId)
+    {
+        return float(formId % 7919) * 0.01f;
+    }
+
+    float EvaluateSine(float phase, float time, float param, float limit)
+    {
+        return (FastMath::Sin(phase + time * param) + 1.f) * limit;
+    }
+
+    float EvaluateStep(float time, float param, float limit)
+    {
+        return time < param ? 0.f : limit;
+    }
+
+    // Time after which EvaluateDecay/EvaluateLinear report done, infinity if they never do.
+    // Follows the closed forms, so the result can be off by rounding in either direction.
+
+    float GetDecayTimeToLimit(float value, float param, float limit)
+    {
+        const bool rising = param * value < 0.f;
+        if (param == 0.f || (rising ? limit < value : limit > value))
+            return 0.f;
+        if (value / limit <= 0.f)
+            return std::numeric_limits<float>::infinity();
+        const float time = param * std::log2(value / limit);
+        return time >= 0.f ? time : std::numeric_limits<float>::infinity();
+    }
+
+    float GetLinearTimeToLimit(float value, float param, float limit)
+    {
+        if (param >= 0.f ? limit < value : limit > value)
+            return 0.f;
+        if (param == 0.f)
+            return std::numeric_limits<float>::infinity();
+        return (limit - value) / param;
+    }
+
+    struct EffectContext
+    {
+        float timeDiff;
+        float time;
+        float phase;
+    };
+
+    // Effect kinds. Each kind is a type with the limit offset of its effects, an evaluator that
+    // returns true once the effect is done and the time until that happens. The dispatch tables
+    // and kernel sets below are generated from EffectKinds, the built in kinds come first in the
+    // order of their effect functions.
+
+    struct DecayEffect
+    {
+        static constexpr int32_t kFunction = 1;
+        static constexpr float kLimitOffset = kDecayLimitOffset;
+        static bool Evaluate(float& value, float param, float limit, int32_t, EffectContext const& context) { return EvaluateDecay(value, param, limit, context.timeDiff); }
+        static float TimeToLimit(float value, float param, float limit) { return GetDecayTimeToLimit(value, param, limit); }
+    };
+
+    struct LinearEffect
+    {
+        static constexpr int32_t kFunction = 2;
+        static constexpr float kLimitOffset = kLinearLimitOffset;
+        static bool Evaluate(float& value, float param, float limit, int32_t, EffectContext const& context) { return EvaluateLinear(value, param, limit, context.timeDiff); }
+        static float TimeToLimit(float value, float param, float limit) { return GetLinearTimeToLimit(value, param, limit); }
+    };
+
+    // Sine and step effects are done after their next evaluation
+
+    struct SineEffect
+    {
+        static constexpr int32_t kFunction = 3;
+        static constexpr float kLimitOffset = 0.f;
+        static bool Evaluate(float& value, float param, float limit, int32_t, EffectContext const& context)
+        {
+            value = EvaluateSine(context.phase, context.time, param, limit);
+            return true;
+        }
+        static float TimeToLimit(float, float, float) { return 0.f; }
+    };
+
+    struct StepEffect
+    {
+        static constexpr int32_t kFunction = 4;
+        static constexpr float kLimitOffset = 0.f;
+        static bool Evaluate(float& value, float param, float limit, int32_t, EffectContext const& context)
+        {
+            value = EvaluateStep(context.time, param, limit);
+            return true;
+        }
+        static float TimeToLimit(float, float, float) { return 0.f; }
+    };
+
+    // limit times a registered curve at param periods per game day. Curves depend on the game time
+    // only, so they never retire and their projection stays exact.
+    struct CurveEffect
+    {
+        static constexpr float kLimitOffset = 0.f;
+        static bool Evaluate(float& value, float param, float limit, int32_t function, EffectContext const& context)
+        {
+            value = limit * effectCurves.Get(static_cast<uint32_t>(function - kFirstCurveFunction)).Sample(context.time * param);
+            return false;
+        }
+        static float TimeToLimit(float, float, float) { return std::numeric_limits<float>::infinity(); }
+    };
+
+    // Any other function, the effect keeps its value and is retired at its next evaluation
+    struct UnknownEffect
+    {
+        static constexpr float kLimitOffset = 0.f;
+        static bool Evaluate(float&, float, float, int32_t, EffectContext const&) { return true; }
+        static float TimeToLimit(float, float, float) { return 0.f; }
+    };
+
+    template <typename... Kinds>
+    struct EffectKindList
+    {
+        static constexpr uint32_t kCount = sizeof...(Kinds);
+
+        template <typename Kind>
+        static constexpr uint32_t IndexOf()
+        {
+            constexpr bool matches[] = { std::is_same_v<Kind, Kinds>... };
+            for (uint32_t i = 0; i < kCount; ++i)
+            {
+                if (matches[i])
+                    return i;
+            }
+            return kCount;
+        }
+    };
+
+    using EffectKinds = EffectKindList<DecayEffect, LinearEffect, SineEffect, StepEffect, CurveEffect, UnknownEffect>;
+
+    constexpr uint32_t kEffectKindCount = EffectKinds::kCount;
+    constexpr uint32_t kBuiltinEffectCount = EffectKinds::IndexOf<CurveEffect>();
+    constexpr uint32_t kCurveEffectKind = EffectKinds::IndexOf<CurveEffect>();
+    constexpr uint32_t kUnknownEffectKind = EffectKinds::IndexOf<UnknownEffect>();
+
+    static_assert(DecayEffect::kFunction == EffectKinds::IndexOf<DecayEffect>() + 1 && LinearEffect::kFunction == EffectKinds::IndexOf<LinearEffect>() + 1 &&
+                      SineEffect::kFunction == EffectKinds::IndexOf<SineEffect>() + 1 && StepEffect::kFunction == EffectKinds::IndexOf<StepEffect>() + 1,
+        "Built in effect kinds must be listed in the order of their functions");
+    static_assert(kBuiltinEffectCount < uint32_t(kFirstCurveFunction), "Curve functions overlap the built in ones");
+
+    // Kind of an effect function. Static effects are bucketed by it when their function is set, only
+    // single effects look it up on evaluation.
+    constexpr uint32_t GetEffectKind(int32_t function)
+    {
+        if (function >= 1 && function <= int32_t(kBuiltinEffectCount))
+            return static_cast<uint32_t>(function - 1);
+        if (function >= kFirstCurveFunction && function < kFirstCurveFunction + int32_t(kMaxEffectCurves))
+            return kCurveEffectKind;
+        return kUnknownEffectKind;
+    }
+
+    struct EffectKindInfo
+    {
+        bool (*evaluate)(float& value, float param, float limit, int32_t function, EffectContext const& context);
+        float (*timeToLimit)(float value, float param, float limit);
+        float limitOffset;
+    };
+
+    template <typename... Kinds>
+    constexpr std::array<EffectKindInfo, sizeof...(Kinds)> MakeEffectKindInfos(EffectKindList<Kinds...>)
+    {
+        return { { { Kinds::Evaluate, Kinds::TimeToLimit, Kinds::kLimitOffset }... } };
+    }
+
+    constexpr auto kEffectKindInfos = MakeEffectKindInfos(EffectKinds{});
+
+    float GetEffectLimitOffset(int32_t function)
+    {
+        return kEffectKindInfos[GetEffectKind(function)].limitOffset;
+    }
+
+    // Evaluates any effect function, time is the game time the effect is evaluated at
+    bool EvaluateEffect(float& value, int32_t function, float param, float limit, float timeDiff, float time, uint32_t formId)
+    {
+        const EffectContext context{ timeDiff, time, GetSinePhase(formId) };
+        return kEffectKindInfos[GetEffectKind(function)].evaluate(value, param, limit, function, context);
+    }
+
+    float GetTimeToLimit(int32_t function, float value, float param, float limit)
+    {
+        return kEffectKindInfos[GetEffectKind(function)].timeToLimit(value, param, limit);
+    }
+
+    const uint32_t kEffectBatchSize = 64;
+
+    // Effects of the same kind gathered from the static effect columns
+    struct EffectBatch
+    {
+        alignas(32) float values[kEffectBatchSize];
+        alignas(32) float params[kEffectBatchSize];
+        alignas(32) float limits[kEffectBatchSize];
+        // Only curves need the function, it picks the curve
+        int32_t functions[kEffectBatchSize];
+        uint32_t indices[kEffectBatchSize];
+        uint32_t count = 0;
+
+        // Vector kernels always process whole registers, the unused tail is kept inert
+        void PadTail()
+        {
+            for (uint32_t i = count; i < (count + 7) / 8 * 8; ++i)
+            {
+                values[i] = 0.f;
+                params[i] = 1.f;
+                limits[i] = 0.f;
+            }
+        }
+    };
+
+    // Updates batch.values in place and returns a bit per effect that reached its limit
+    using EffectKernel = uint64_t (*)(EffectBatch& batch, EffectContext const& context);
+
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    struct EffectKernelSet
+    {
+        const char* name;
+        std::array<EffectKernel, kEffectKindCount> kernels;
+
+        EffectKernel Get(uint32_t kind) const { return kernels[kind]; }
+    };
+
+    uint64_t BatchMask(uint32_t count)
+    {
+        return count >= 64 ? ~0ull : (1ull << count) - 1;
+    }
+
+    // The reference kernel of every kind, its evaluator inlined into the loop
+    template <typename Kind>
+    uint64_t ScalarKernel(EffectBatch& batch, EffectContext const& context)
+    {
+        uint64_t done = 0;
+        for (uint32_t i = 0; i < batch.count; ++i)
+        {
+            if (Kind::Evaluate(batch.values[i], batch.params[i], batch.limits[i], batch.functions[i], context))
+                done |= 1ull << i;
+        }
+        return done;
+    }
+
+    // Kernel of Kind at a SIMD level, the scalar one unless a vector kernel is specialized below
+    template <typename Kind, SimdLevel Level>
+    struct KindKernel
+    {
+        static constexpr EffectKernel kernel = ScalarKernel<Kind>;
+    };
+
+    template <SimdLevel Level, typename... Kinds>
+    constexpr std::array<EffectKernel, sizeof...(Kinds)> MakeKernels(EffectKindList<Kinds...>)
+    {
+        return { KindKernel<Kinds, Level>::kernel... };
+    }
+
+#if defined(_M_X64) || defined(__x86_64__)
+    // Vector kernels of the built in kinds. Results are bit identical to the scalar reference, Exp2
+    // and Sin repeat the operations of FastMath::Exp2 and FastMath::Sin lane by lane.
+
+    __m128 Exp2SSE2(__m128 x)
+    {
+        const __m128 clamped = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-127.f)), _mm_set1_ps(128.f));
+        const __m128i whole = _mm_cvtps_epi32(clamped);
+        const __m128 fraction = _mm_sub_ps(clamped, _mm_cvtepi32_ps(whole));
+
+        __m128 poly = _mm_set1_ps(FastMath::kExp2[0]);
+        for (size_t i = 1; i < std::size(FastMath::kExp2); ++i)
+            poly = _mm_add_ps(_mm_mul_ps(poly, fraction), _mm_set1_ps(FastMath::kExp2[i]));
+
+        // whole == 128 yields an infinite exponent, whole == -127 a zero
+        const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(whole, _mm_set1_epi32(127)), 23));
+        const __m128 result = _mm_mul_ps(poly, scale);
+        return _mm_or_ps(result, _mm_cmpunord_ps(x, x));
+    }
+
+    __m128 SelectSSE2(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    uint64_t DecaySSE2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m128 timeDiff = _mm_set1_ps(context.timeDiff);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 offset = _mm_set1_ps(kDecayLimitOffset);
+        uint64_t done = 0;
+        for (uint32_t i = 0; i < batch.count; i += 4)
+        {
+            const __m128 value = _mm_load_ps(batch.values + i);
+            const __m128 param = _mm_load_ps(batch.params + i);
+            const __m128 limit = _mm_load_ps(batch.limits + i);
+
+            const __m128 result = _mm_mul_ps(value, Exp2SSE2(_mm_sub_ps(zero, _mm_div_ps(timeDiff, param))));
+            const __m128 upper = _mm_cmplt_ps(_mm_mul_ps(param, value), zero);
+            const __m128 reached = SelectSSE2(upper, _mm_cmplt_ps(limit, result), _mm_cmpgt_ps(limit, result));
+            const __m128 clamped = SelectSSE2(upper, _mm_add_ps(limit, offset), _mm_sub_ps(limit, offset));
+
+            _mm_store_ps(batch.values + i, SelectSSE2(reached, clamped, result));
+            done |= uint64_t(_mm_movemask_ps(reached)) << i;
+        }
+        return done & BatchMask(batch.count);
+    }
+
+    uint64_t LinearSSE2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m128 timeDiff = _mm_set1_ps(context.timeDiff);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 offset = _mm_set1_ps(kLinearLimitOffset);
+        uint64_t done = 0;
+        for (uint32_t i = 0; i < batch.count; i += 4)
+        {
+            const __m128 value = _mm_load_ps(batch.values + i);
+            const __m128 param = _mm_load_ps(batch.params + i);
+            const __m128 limit = _mm_load_ps(batch.limits + i);
+
+            const __m128 result = _mm_add_ps(value, _mm_mul_ps(timeDiff, param));
+            const __m128 upper = _mm_cmpge_ps(param, zero);
+            const __m128 reached = SelectSSE2(upper, _mm_cmplt_ps(limit, result), _mm_cmpgt_ps(limit, result));
+            const __m128 clamped = SelectSSE2(upper, _mm_add_ps(limit, offset), _mm_sub_ps(limit, offset));
+
+            _mm_store_ps(batch.values + i, SelectSSE2(reached, clamped, result));
+            done |= uint64_t(_mm_movemask_ps(reached)) << i;
+        }
+        return done & BatchMask(batch.count);
+    }
+
+    __m128 SinSSE2(__m128 x)
+    {
+        const __m128 magic = _mm_set1_ps(FastMath::kRoundMagic);
+        const __m128 n = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(FastMath::kInvPi)), magic), magic);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(FastMath::kPiA)));
+        r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(FastMath::kPiB)));
+        r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(FastMath::kPiC)));
+
+        const __m128 r2 = _mm_mul_ps(r, r);
+        __m128 poly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(FastMath::kSin4), r2), _mm_set1_ps(FastMath::kSin3));
+        poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(FastMath::kSin2));
+        poly = _mm_add_ps(_mm_mul_ps(poly, r2), _mm_set1_ps(FastMath::kSin1));
+        const __m128 sine = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), poly));
+
+        const __m128 two = _mm_set1_ps(2.f);
+        const __m128 half = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(n, _mm_set1_ps(0.5f)), magic), magic);
+        const __m128 odd = _mm_sub_ps(n, _mm_mul_ps(two, half));
+        return _mm_mul_ps(sine, _mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(_mm_mul_ps(two, odd), odd)));
+    }
+
+    uint64_t SineSSE2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m128 phase = _mm_set1_ps(context.phase);
+        const __m128 time = _mm_set1_ps(context.time);
+        const __m128 one = _mm_set1_ps(1.f);
+        for (uint32_t i = 0; i < batch.count; i += 4)
+        {
+            const __m128 angle = _mm_add_ps(phase, _mm_mul_ps(time, _mm_load_ps(batch.params + i)));
+            _mm_store_ps(batch.values + i, _mm_mul_ps(_mm_add_ps(SinSSE2(angle), one), _mm_load_ps(batch.limits + i)));
+        }
+        return BatchMask(batch.count);
+    }
+
+    uint64_t StepSSE2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m128 time = _mm_set1_ps(context.time);
+        for (uint32_t i = 0; i < batch.count; i += 4)
+        {
+            const __m128 before = _mm_cmplt_ps(time, _mm_load_ps(batch.params + i));
+            _mm_store_ps(batch.values + i, _mm_andnot_ps(before, _mm_load_ps(batch.limits + i)));
+        }
+        return BatchMask(batch.count);
+    }
+
+    SLAM_TARGET_AVX2 __m256 Exp2AVX2(__m256 x)
+    {
+        const __m256 clamped = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-127.f)), _mm256_set1_ps(128.f));
+        const __m256i whole = _mm256_cvtps_epi32(clamped);
+        const __m256 fraction = _mm256_sub_ps(clamped, _mm256_cvtepi32_ps(whole));
+
+        __m256 poly = _mm256_set1_ps(FastMath::kExp2[0]);
+        for (size_t i = 1; i < std::size(FastMath::kExp2); ++i)
+            poly = _mm256_add_ps(_mm256_mul_ps(poly, fraction), _mm256_set1_ps(FastMath::kExp2[i]));
+
+        const __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(whole, _mm256_set1_epi32(127)), 23));
+        const __m256 result = _mm256_mul_ps(poly, scale);
+        return _mm256_or_ps(result, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+    }
+
+    SLAM_TARGET_AVX2 uint64_t DecayAVX2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m256 timeDiff = _mm256_set1_ps(context.timeDiff);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 offset = _mm256_set1_ps(kDecayLimitOffset);
+        uint64_t done = 0;
+        for (uint32_t i = 0; i < batch.count; i += 8)
+        {
+            const __m256 value = _mm256_load_ps(batch.values + i);
+            const __m256 param = _mm256_load_ps(batch.params + i);
+            const __m256 limit = _mm256_load_ps(batch.limits + i);
+
+            const __m256 result = _mm256_mul_ps(value, Exp2AVX2(_mm256_sub_ps(zero, _mm256_div_ps(timeDiff, param))));
+            const __m256 upper = _mm256_cmp_ps(_mm256_mul_ps(param, value), zero, _CMP_LT_OQ);
+            const __m256 reached = _mm256_blendv_ps(_mm256_cmp_ps(limit, result, _CMP_GT_OQ), _mm256_cmp_ps(limit, result, _CMP_LT_OQ), upper);
+            const __m256 clamped = _mm256_blendv_ps(_mm256_sub_ps(limit, offset), _mm256_add_ps(limit, offset), upper);
+
+            _mm256_store_ps(batch.values + i, _mm256_blendv_ps(result, clamped, reached));
+            done |= uint64_t(_mm256_movemask_ps(reached)) << i;
+        }
+        return done & BatchMask(batch.count);
+    }
+
+    SLAM_TARGET_AVX2 uint64_t LinearAVX2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m256 timeDiff = _mm256_set1_ps(context.timeDiff);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 offset = _mm256_set1_ps(kLinearLimitOffset);
+        uint64_t done = 0;
+        for (uint32_t i = 0; i < batch.count; i += 8)
+        {
+            const __m256 value = _mm256_load_ps(batch.values + i);
+            const __m256 param = _mm256_load_ps(batch.params + i);
+            const __m256 limit = _mm256_load_ps(batch.limits + i);
+
+            const __m256 result = _mm256_add_ps(value, _mm256_mul_ps(timeDiff, param));
+            const __m256 upper = _mm256_cmp_ps(param, zero, _CMP_GE_OQ);
+            const __m256 reached = _mm256_blendv_ps(_mm256_cmp_ps(limit, result, _CMP_GT_OQ), _mm256_cmp_ps(limit, result, _CMP_LT_OQ), upper);
+            const __m256 clamped = _mm256_blendv_ps(_mm256_sub_ps(limit, offset), _mm256_add_ps(limit, offset), upper);
+
+            _mm256_store_ps(batch.values + i, _mm256_blendv_ps(result, clamped, reached));
+            done |= uint64_t(_mm256_movemask_ps(reached)) << i;
+        }
+        return done & BatchMask(batch.count);
+    }
+
+    SLAM_TARGET_AVX2 __m256 SinAVX2(__m256 x)
+    {
+        const __m256 magic = _mm256_set1_ps(FastMath::kRoundMagic);
+        const __m256 n = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(FastMath::kInvPi)), magic), magic);
+        __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(FastMath::kPiA)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(FastMath::kPiB)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(FastMath::kPiC)));
+
+        const __m256 r2 = _mm256_mul_ps(r, r);
+        __m256 poly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(FastMath::kSin4), r2), _mm256_set1_ps(FastMath::kSin3));
+        poly = _mm256_add_ps(_mm256_mul_ps(poly, r2), _mm256_set1_ps(FastMath::kSin2));
+        poly = _mm256_add_ps(_mm256_mul_ps(poly, r2), _mm256_set1_ps(FastMath::kSin1));
+        const __m256 sine = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), poly));
+
+        const __m256 two = _mm256_set1_ps(2.f);
+        const __m256 half = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(n, _mm256_set1_ps(0.5f)), magic), magic);
+        const __m256 odd = _mm256_sub_ps(n, _mm256_mul_ps(two, half));
+        return _mm256_mul_ps(sine, _mm256_sub_ps(_mm256_set1_ps(1.f), _mm256_mul_ps(_mm256_mul_ps(two, odd), odd)));
+    }
+
+    SLAM_TARGET_AVX2 uint64_t SineAVX2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m256 phase = _mm256_set1_ps(context.phase);
+        const __m256 time = _mm256_set1_ps(context.time);
+        const __m256 one = _mm256_set1_ps(1.f);
+        for (uint32_t i = 0; i < batch.count; i += 8)
+        {
+            const __m256 angle = _mm256_add_ps(phase, _mm256_mul_ps(time, _mm256_load_ps(batch.params + i)));
+            _mm256_store_ps(batch.values + i, _mm256_mul_ps(_mm256_add_ps(SinAVX2(angle), one), _mm256_load_ps(batch.limits + i)));
+        }
+        return BatchMask(batch.count);
+    }
+
+    SLAM_TARGET_AVX2 uint64_t StepAVX2(EffectBatch& batch, EffectContext const& context)
+    {
+        const __m256 time = _mm256_set1_ps(context.time);
+        for (uint32_t i = 0; i < batch.count; i += 8)
+        {
+            const __m256 before = _mm256_cmp_ps(time, _mm256_load_ps(batch.params + i), _CMP_LT_OQ);
+            _mm256_store_ps(batch.values + i, _mm256_andnot_ps(before, _mm256_load_ps(batch.limits + i)));
+        }
+        return BatchMask(batch.count);
+    }
+
+    bool CpuSupportsAVX2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        const int osxsave = 1 << 27;
+        const int avx = 1 << 28;
+        if ((info[2] & (osxsave | avx)) != (osxsave | avx) || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    template <> struct KindKernel<DecayEffect, SimdLevel::SSE2> { static constexpr EffectKernel kernel = DecaySSE2; };
+    template <> struct KindKernel<LinearEffect, SimdLevel::SSE2> { static constexpr EffectKernel kernel = LinearSSE2; };
+    template <> struct KindKernel<SineEffect, SimdLevel::SSE2> { static constexpr EffectKernel kernel = SineSSE2; };
+    template <> struct KindKernel<StepEffect, SimdLevel::SSE2> { static constexpr EffectKernel kernel = StepSSE2; };
+    template <> struct KindKernel<DecayEffect, SimdLevel::AVX2> { static constexpr EffectKernel kernel = DecayAVX2; };
+    template <> struct KindKernel<LinearEffect, SimdLevel::AVX2> { static constexpr EffectKernel kernel = LinearAVX2; };
+    template <> struct KindKernel<SineEffect, SimdLevel::AVX2> { static constexpr EffectKernel kernel = SineAVX2; };
+    template <> struct KindKernel<StepEffect, SimdLevel::AVX2> { static constexpr EffectKernel kernel = StepAVX2; };
+#endif
+
+    SimdLevel GetSupportedSimdLevel()
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+        return CpuSupportsAVX2() ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    EffectKernelSet const& GetEffectKernels(SimdLevel level)
+    {
+        static const EffectKernelSet scalar{ "scalar", MakeKernels<SimdLevel::Scalar>(EffectKinds{}) };
+#if defined(_M_X64) || defined(__x86_64__)
+        static const EffectKernelSet sse2{ "SSE2", MakeKernels<SimdLevel::SSE2>(EffectKinds{}) };
+        static const EffectKernelSet avx2{ "AVX2", MakeKernels<SimdLevel::AVX2>(EffectKinds{}) };
+        switch (level)
+        {
+        case SimdLevel::AVX2: return avx2;
+        case SimdLevel::SSE2: return sse2;
+        default: break;
+        }
+#endif
+        return scalar;
+    }
+
+    EffectKernelSet const* effectKernels = &GetEffectKernels(GetSupportedSimdLevel());
+}
\ No newline at end of file
@@ -0,0 +1,872 @@
+#pragma once
+
+#include "ActorStore.h"
+#include "Arousal.h"
+#include "ArousalRanking.h"
+#include "ArousalSnapshots.h"
+#include "Serialization.h"
+#include "UpdatePool.h"
+
+// Host independent part of the plugin. Actors are addressed by formId and game time is passed in,
+// so the same code runs behind the Papyrus natives and in the benchmarks.
+namespace slaModules
+{
+    ShardedActorStore arousalData;
+    // What readers get without touching arousalData, kept current by PublishChanges and the updates
+    ArousalSnapshots arousalSnapshots;
+    // Published actors by arousal. In lazy mode actors rank with the arousal of their last update.
+    ArousalRanking arousalRanking;
+    // Scripts on one thread usually alternate between a handful of actors
+    thread_local ActorLookupCache<4> actorCache;
+
+    // In lazy mode actors are only updated once an effect reaches its limit, readers project
+    // the stored values to the current game time and writers bring the actor up to date first.
+    std::atomic<bool> lazyUpdate{ false };
+
+    // Provided by the host, only queried in lazy mode
+    float (*currentGameTime)() = nullptr;
+
+    // Actors natives used lately, the update scheduler updates them first. Lossy on purpose: when
+    // the ring is full the oldest entries are overwritten, and nothing is noted while no scheduler drains it.
+    class RecentActors
+    {
+    public:
+        static constexpr uint32_t kSize = 256;
+
+        void SetEnabled(bool enabled) { this->enabled.store(enabled, std::memory_order_relaxed); }
+
+        void Note(uint32_t formId)
+        {
+            if (!enabled.load(std::memory_order_relaxed))
+                return;
+            const uint32_t pos = next.fetch_add(1, std::memory_order_relaxed) % kSize;
+            entries[pos].store(formId, std::memory_order_relaxed);
+        }
+
+        // Appends the noted formIds to formIds and forgets them, an actor may appear more than once
+        void Drain(std::vector<uint32_t>& formIds)
+        {
+            for (auto& entry : entries)
+            {
+                if (const uint32_t formId = entry.exchange(0, std::memory_order_relaxed))
+                    formIds.push_back(formId);
+            }
+        }
+
+    private:
+        std::atomic<bool> enabled{ false };
+        std::atomic<uint32_t> next{ 0 };
+        std::array<std::atomic<uint32_t>, kSize> entries{};
+    };
+
+    RecentActors recentActors;
+
+    // Every change readers can see goes through these two, which keep the ranking in step with the
+    // snapshots. The caller holds the actor's shard lock, so the summary read back is the one it published last.
+    void PublishSummary(uint32_t formId, ArousalSummary const& summary)
+    {
+        ArousalSummary previous;
+        const bool ranked = arousalSnapshots.Read(formId, previous);
+        arousalSnapshots.Publish(formId, summary);
+        // Constant actors are published again on every sweep
+        if (!ranked || previous.arousal != summary.arousal)
+            arousalRanking.Update(formId, ranked, previous.arousal, summary.arousal);
+    }
+
+    void WithdrawSummary(uint32_t formId)
+    {
+        ArousalSummary previous;
+        if (!arousalSnapshots.Read(formId, previous))
+            return;
+        arousalSnapshots.Withdraw(formId);
+        arousalRanking.Remove(formId, previous.arousal);
+    }
+
+    // The data of one actor with its shard locked for as long as this lives. Natives on other
+    // actors of the same shard wait, so keep it short and never hold two at once. Accessors that
+    // may change the actor wake it up, readers leave dormant actors asleep.
+    class LockedArousalData
+    {
+    public:
+        LockedArousalData(uint32_t formId, bool wake) :
+            formId(formId), shard(arousalData.ShardOf(formId)), guard(shard.lock)
+        {
+            const ActorHandle handle = actorCache.GetOrCreateHandle(shard.store, formId);
+            if (wake)
+                shard.store.Wake(handle.slot);
+            data = shard.store.Resolve(handle);
+            recentActors.Note(formId);
+        }
+
+        uint32_t GetFormId() const { return formId; }
+        ArousalData* operator->() const { return data; }
+        ArousalData& operator*() const { return *data; }
+
+        // Writers call this after changing the data, so readers see the change and UpdateAllActors
+        // retires the actor in time
+        void PublishChanges() const
+        {
+            PublishSummary(formId, data->GetSummary());
+            if (lazyUpdate)
+                shard.store.ScheduleExpiry(formId);
+        }
+
+    private:
+        uint32_t formId;
+        ShardedActorStore::Shard& shard;
+        std::unique_lock<std::mutex> guard;
+        ArousalData* data;
+    };
+
+    LockedArousalData GetArousalData(uint32_t formId)
+    {
+        return LockedArousalData(formId, true);
+    }
+
+    // time receives the game time the values have to be read at
+    LockedArousalData GetArousalDataForRead(uint32_t formId, float& time)
+    {
+        LockedArousalData data(formId, false);
+        time = data->GetLastUpdate();
+        if (lazyUpdate)
+        {
+            time = currentGameTime();
+            if (data->NeedsUpdate(time))
+            {
+                data->UpdateSingleActorArousal(formId, time);
+                data.PublishChanges();
+            }
+        }
+        return data;
+    }
+
+    // For writes that leave the arousal and every effect function alone, like the auxiliary values.
+    // Nothing changes over time afterwards, so dormant actors stay asleep.
+    LockedArousalData GetArousalDataForAux(uint32_t formId)
+    {
+        return LockedArousalData(formId, false);
+    }
+
+    LockedArousalData GetArousalDataForWrite(uint32_t formId)
+    {
+        LockedArousalData data(formId, true);
+        if (lazyUpdate)
+        {
+            const float time = currentGameTime();
+            if (time > data->GetLastUpdate())
+                data->UpdateSingleActorArousal(formId, time);
+        }
+        return data;
+    }
+
+    // Lock free. False if the actor has no summary or, in lazy mode, it no longer holds at the current
+    // game time, the caller has to read the data then.
+    bool ReadSummary(uint32_t formId, ArousalSummary& summary)
+    {
+        recentActors.Note(formId);
+        if (!arousalSnapshots.Read(formId, summary))
+            return false;
+        return !lazyUpdate || (summary.lastUpdate && currentGameTime() < summary.nextExpiry);
+    }
+
+    float ReadArousal(uint32_t formId)
+    {
+        ArousalSummary summary;
+        // Lazy mode projects the arousal to the current time, the summary only has it for constant actors
+        if (ReadSummary(formId, summary) && (!lazyUpdate || summary.constant))
+            return summary.arousal;
+        float time;
+        auto data = GetArousalDataForRead(formId, time);
+        return data->GetArousalAt(formId, time);
+    }
+
+    bool ReadStaticEffectActive(uint32_t formId, int32_t effectIdx)
+    {
+        ArousalSummary summary;
+        if (effectIdx >= 0 && effectIdx < 64 && ReadSummary(formId, summary))
+            return (summary.activeStaticEffects >> effectIdx) & 1;
+        float time;
+        return GetArousalDataForRead(formId, time)->IsStaticEffectActive(effectIdx);
+    }
+
+    int32_t ReadDynamicEffectCount(uint32_t formId)
+    {
+        ArousalSummary summary;
+        if (ReadSummary(formId, summary))
+            return summary.dynamicEffectCount;
+        float time;
+        return GetArousalDataForRead(formId, time)->GetDynamicEffectCount();
+    }
+
+    uint32_t EraseActorsUpdatedBefore(float time)
+    {
+        return arousalData.EraseIf([time](uint32_t formId, ArousalData const& data) {
+            if (data.GetLastUpdate() >= time)
+                return false;
+            WithdrawSummary(formId);
+            return true;
+        });
+    }
+
+    void SetLazyUpdateMode(bool enabled)
+    {
+        auto locks = arousalData.LockAll();
+        if (enabled == lazyUpdate)
+            return;
+        lazyUpdate = enabled;
+        for (uint32_t i = 0; i < ShardedActorStore::kShardCount; ++i)
+        {
+            ActorStore& store = arousalData.ShardAt(i).store;
+            if (enabled)
+                store.ScheduleAll();
+            else
+                store.ClearExpiries();
+        }
+    }
+
+    bool UnregisterEffect(std::string_view name)
+    {
+        const uint32_t id = staticEffectRegistry.Unregister(name);
+        if (id == StaticEffectRegistry::kInvalidId)
+            return false;
+        // Clearing the effect changes the arousal, readers and the ranking have to see that
+        const bool lazy = lazyUpdate;
+        for (uint32_t i = 0; i < ShardedActorStore::kShardCount; ++i)
+        {
+            auto& shard = arousalData.ShardAt(i);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            shard.store.ForEach([&](uint32_t formId, ArousalData& data) {
+                if (!data.OnUnregisterStaticEffect(id))
+                    return;
+                PublishSummary(formId, data.GetSummary());
+                if (lazy)
+                    shard.store.ScheduleExpiry(formId);
+            });
+        }
+        return true;
+    }
+
+    // Frees the curves that were replaced or cleared. Curves are only evaluated with the actor's shard
+    // locked, so once every shard was locked after the replacement no update can still hold one.
+    void ReclaimEffectCurves()
+    {
+        auto retired = effectCurves.TakeRetired();
+        if (!retired.empty())
+            arousalData.LockAll();
+    }
+
+    // Never called with a shard locked, reclaiming the replaced curve waits for every shard
+    int32_t RegisterCurve(std::string_view name, std::vector<float> xs, std::vector<float> ys)
+    {
+        const int32_t function = effectCurves.Register(name, std::move(xs), std::move(ys));
+        ReclaimEffectCurves();
+        return function;
+    }
+
+    // Rebuilds the ranking from the published summaries after a load
+    void RankLoadedActors()
+    {
+        auto locks = arousalData.LockAll();
+        std::vector<std::pair<uint32_t, float>> actors;
+        for (uint32_t i = 0; i < ShardedActorStore::kShardCount; ++i)
+        {
+            arousalData.ShardAt(i).store.ForEach([&actors](uint32_t formId, ArousalData const&) {
+                ArousalSummary summary;
+                if (arousalSnapshots.Read(formId, summary))
+                    actors.emplace_back(formId, summary.arousal);
+            });
+        }
+        arousalRanking.FinishLoad(actors);
+    }
+
+    // Updates and publishes the actor in a slot of a locked shard. Actors left with nothing that
+    // changes over time go dormant, returns false for them.
+    bool UpdateLockedActor(ActorStore& store, uint32_t slot, float GameDaysPassed)
+    {
+        uint32_t formId;
+        ArousalData& data = *store.AtSlot(slot, formId);
+        try
+        {
+            data.UpdateSingleActorArousal(formId, GameDaysPassed);
+            PublishSummary(formId, data.GetSummary());
+        }
+        catch (std::exception) {}
+        if (!data.IsConstant())
+            return true;
+        store.SetDormant(slot);
+        return false;
+    }
+
+    // Every shard is one task, its lock is held while the task runs. Dormant actors are skipped,
+    // lazy mode only updates the actors whose expiry has passed.
+    uint32_t UpdateAllActors(float GameDaysPassed)
+    {
+        const bool lazy = lazyUpdate;
+        std::atomic<uint32_t> total{ 0 };
+        UpdatePool::GetSingleton().ParallelFor(ShardedActorStore::kShardCount, 1, [&](size_t begin, size_t end) {
+            thread_local std::vector<uint32_t> expired;
+            for (size_t i = begin; i < end; ++i)
+            {
+                auto& shard = arousalData.ShardAt(static_cast<uint32_t>(i));
+                std::lock_guard<std::mutex> guard(shard.lock);
+                ActorStore& store = shard.store;
+                total.fetch_add(store.Size(), std::memory_order_relaxed);
+                if (lazy)
+                {
+                    expired.clear();
+                    store.PopExpired(GameDaysPassed, expired);
+                    for (uint32_t slot : expired)
+                    {
+                        if (UpdateLockedActor(store, slot, GameDaysPassed))
+                            store.ScheduleSlot(slot);
+                    }
+                    continue;
+                }
+
+                store.ForEachAwake([&](uint32_t slot) { UpdateLockedActor(store, slot, GameDaysPassed); });
+                store.SetDormantTime(GameDaysPassed);
+            }
+        });
+        return total;
+    }
+
+    // 1: dynamic effect names stored inline per actor
+    // 2: shared symbol table, actors reference dynamic effect names by symbol id
+    // 3: varint counts and ids, default static effects elided through a presence bitmap
+    // 4: registered effect curves after the static effect names
+    const uint32_t kSerializationDataVersion = 4;
+    const uint32_t kDataRecord = 'DATA';
+
+    // Encodes the co-save, only used by the game's load and save callbacks on the main thread. Reused
+    // between saves, its buffer keeps the size of the largest record written so far.
+    RecordWriter recordWriter;
+
+    void RevertData()
+    {
+        staticEffectRegistry.Clear();
+        effectCurves.Clear();
+        symbols.Clear();
+
+        {
+            // Publishing takes the actor's shard lock, holding all of them keeps every snapshot entry at one writer
+            auto locks = arousalData.LockAll();
+            for (uint32_t i = 0; i < ShardedActorStore::kShardCount; ++i)
+                arousalData.ShardAt(i).store.Clear();
+            arousalSnapshots.Clear();
+            arousalRanking.Clear();
+        }
+        ReclaimEffectCurves();
+    }
+
+    // Intfc is SKSE::SerializationInterface or a stand-in with the same record functions
+    template <typename Intfc>
+    void LoadData(Intfc* intfc)
+    {
+        uint32_t type;
+        uint32_t version;
+        uint32_t length;
+        bool error = false;
+
+        arousalRanking.StartLoad();
+        while (!error && intfc->GetNextRecordInfo(type, version, length))
+        {
+            switch (type)
+            {
+            case kDataRecord:
+            {
+                if (version >= 1 && version <= kSerializationDataVersion)
+                {
+                    logger::info("Loading data version {}", version);
+                    try
+                    {
+                        RecordReader reader;
+                        reader.Load(intfc, length);
+                        // Sized for the loaded record, the next save starts without reallocating
+                        recordWriter.Reserve(length);
+
+                        const bool compact = version >= 3;
+                        const uint32_t effectCount = compact ? reader.ReadVarint() : reader.Read<uint32_t>();
+                        logger::info("Loading {} effects... ", effectCount);
+
+                        staticEffectRegistry.Reset(std::min<uint32_t>(effectCount, static_cast<uint32_t>(reader.Remaining())));
+                        for (uint32_t i = 0; i < effectCount; ++i)
+                        {
+                            std::string_view effect = compact ? reader.ReadVarintString() : reader.ReadString();
+                            uint32_t id = compact ? reader.ReadVarint() : reader.Read<uint32_t>();
+                            staticEffectRegistry.Assign(id, effect);
+                            // logger::info("Added effect '{}' with id {}", effect, id);
+                        }
+                        staticEffectRegistry.FinishLoad();
+
+                        if (version >= 4)
+                        {
+                            const uint32_t curveCount = reader.ReadVarint();
+                            for (uint32_t i = 0; i < curveCount; ++i)
+                            {
+                                const std::string name(reader.ReadVarintString());
+                                const uint32_t pointCount = reader.ReadVarint();
+                                if (pointCount > reader.Remaining() / (2 * sizeof(float)))
+                                    throw std::length_error("savegame data ended unexpected");
+                                std::vector<float> xs(pointCount);
+                                std::vector<float> ys(pointCount);
+                                for (uint32_t j = 0; j < pointCount; ++j)
+                                {
+                                    xs[j] = reader.Read<float>();
+                                    ys[j] = reader.Read<float>();
+                                }
+                                if (!name.empty())
+                                    effectCurves.Assign(i, name, std::move(xs), std::move(ys));
+                            }
+                        }
+
+                        std::vector<uint32_t> symbolMap;
+                        if (version >= 2)
+                        {
+                            uint32_t symbolCount = compact ? reader.ReadVarint() : reader.Read<uint32_t>();
+                            symbolMap.reserve(std::min<size_t>(symbolCount, reader.Remaining()));
+                            for (uint32_t i = 0; i < symbolCount; ++i)
+                                symbolMap.push_back(symbols.Intern(compact ? reader.ReadVarintString() : reader.ReadString()));
+                        }
+
+                        uint32_t entryCount = compact ? reader.ReadVarint() : reader.Read<uint32_t>();
+                        logger::info("Loading {} data sets... ", entryCount);
+
+                        for (uint32_t i = 0; i < entryCount; ++i)
+                        {
+                            uint32_t formId = reader.Read<uint32_t>();
+                            // logger::info("Loading data for actor {}...", formId);
+                            ArousalData data(reader, version, symbolMap);
+                            uint32_t newFormId;
+                            if (!intfc->ResolveFormID(formId, newFormId))
+                                continue;
+                            auto loaded = GetArousalData(newFormId);
+                            *loaded = std::move(data);
+                            loaded.PublishChanges();
+                        }
+                    }
+                    catch (std::exception)
+                    {
+                        error = true;
+                    }
+                }
+                else
+                    error = true;
+            }
+            break;
+
+            default:
+                logger::info("unhandled type {}", type);
+                error = true;
+                break;
+            }
+        }
+
+        RankLoadedActors();
+
+        if (error)
+            logger::info("Encountered error while loading data");
+    }
+
+    // writer belongs to the caller, saves may run on the main thread and a VM thread at the same time
+    template <typename Intfc>
+    void SaveData(Intfc* intfc, RecordWriter& writer)
+    {
+        if (intfc->OpenRecord(kDataRecord, kSerializationDataVersion))
+        {
+            writer.Clear();
+            // Free ids are written with an empty name
+            const auto effects = staticEffectRegistry.GetNames();
+            writer.WriteVarint(static_cast<uint32_t>(effects.size()));
+            for (uint32_t id = 0; id < effects.size(); ++id)
+            {
+                writer.WriteVarintString(effects[id]);
+                writer.WriteVarint(id);
+            }
+
+            // Ids without a curve are written with an empty name and no points
+            const auto curves = effectCurves.GetEntries();
+            writer.WriteVarint(static_cast<uint32_t>(curves.size()));
+            for (auto const& entry : curves)
+            {
+                writer.WriteVarintString(entry.name);
+                const auto& xs = entry.xs;
+                const auto& ys = entry.ys;
+                writer.WriteVarint(static_cast<uint32_t>(xs.size()));
+                for (size_t i = 0; i < xs.size(); ++i)
+                {
+                    writer.Write(xs[i]);
+                    writer.Write(ys[i]);
+                }
+            }
+
+            // Every shard stays locked, so the actor count matches the actors written and any
+            // symbol an actor refers to is already in the table
+            auto locks = arousalData.LockAll();
+            const uint32_t symbolCount = symbols.Size();
+            writer.WriteVarint(symbolCount);
+            for (uint32_t i = 0; i < symbolCount; ++i)
+                writer.WriteVarintString(symbols.Name(i));
+            uint32_t actorCount = 0;
+            for (uint32_t i = 0; i < ShardedActorStore::kShardCount; ++i)
+                actorCount += arousalData.ShardAt(i).store.Size();
+            writer.WriteVarint(actorCount);
+            for (uint32_t i = 0; i < ShardedActorStore::kShardCount; ++i)
+            {
+                arousalData.ShardAt(i).store.ForEach([&writer](uint32_t formId, ArousalData const& data) {
+                    writer.Write(formId);
+                    data.Serialize(writer);
+                });
+            }
+            if (!writer.Commit(intfc))
+                logger::info("Failed to write {} bytes of data", writer.Size());
+        }
+    }
+
+    // Bodies of the Papyrus natives, the plugin only turns actors into formIds and the replay calls
+    // them with the recorded arguments. Same names as the natives, which is why they get a namespace
+    // of their own. An actor of 0 is none, and like every failure it returns the native's fallback.
+    // Natives that take GameDaysPassed update to it, the others read at currentGameTime in lazy mode.
+    namespace Natives
+    {
+        uint32_t RequireActor(uint32_t formId)
+        {
+            if (!formId)
+                throw std::invalid_argument("Attempt to get arousal data for none actor");
+            return formId;
+        }
+
+        uint32_t GetStaticEffectCount()
+        {
+            return staticEffectRegistry.Size();
+        }
+
+        uint32_t RegisterStaticEffect(std::string_view name)
+        {
+            // Actors grow their static effect storage on first use, registering does not touch them
+            return staticEffectRegistry.Register(name);
+        }
+
+        bool UnregisterStaticEffect(std::string_view name)
+        {
+            return UnregisterEffect(name);
+        }
+
+        int32_t RegisterEffectCurve(std::string_view name, std::vector<float> xs, std::vector<float> ys)
+        {
+            try {
+                return RegisterCurve(name, std::move(xs), std::move(ys));
+            }
+            catch (std::exception) { return 0; }
+        }
+
+        int32_t GetEffectCurveFunction(std::string_view name)
+        {
+            return effectCurves.Find(name);
+        }
+
+        int32_t GetDynamicEffectCount(uint32_t formId)
+        {
+            try {
+                return ReadDynamicEffectCount(RequireActor(formId));
+            }
+            catch (std::exception) { return 0; }
+        }
+
+        const char* GetDynamicEffect(uint32_t formId, int32_t number)
+        {
+            try {
+                float time;
+                auto data = GetArousalDataForRead(RequireActor(formId), time);
+                return data->GetDynamicEffect(number);
+            }
+            catch (std::exception) { return ""; }
+        }
+
+        float GetDynamicEffectValueByName(uint32_t formId, std::string_view effectId)
+        {
+            try {
+                float time;
+                auto data = GetArousalDataForRead(RequireActor(formId), time);
+                return data->GetDynamicEffectValueByNameAt(effectId, formId, time);
+            }
+            catch (std::exception) { return 0.0; }
+        }
+
+        float GetDynamicEffectValue(uint32_t formId, int32_t number)
+        {
+            try {
+                float time;
+                auto data = GetArousalDataForRead(RequireActor(formId), time);
+                return data->GetDynamicEffectValueAt(number, formId, time);
+            }
+            catch (std::exception) { return std::numeric_limits<float>::lowest(); }
+        }
+
+        bool IsStaticEffectActive(uint32_t formId, int32_t effectIdx)
+        {
+            try {
+                return ReadStaticEffectActive(RequireActor(formId), effectIdx);
+            }
+            catch (std::exception) { return false; }
+        }
+
+        float GetStaticEffectValue(uint32_t formId, int32_t effectIdx)
+        {
+            try {
+                float time;
+                auto data = GetArousalDataForRead(RequireActor(formId), time);
+                return data->GetStaticEffectValueAt(effectIdx, formId, time);
+            }
+            catch (std::exception) { return 0.f; }
+        }
+
+        float GetStaticEffectParam(uint32_t formId, int32_t effectIdx)
+        {
+            try {
+                float time;
+                return GetArousalDataForRead(RequireActor(formId), time)->GetStaticArousalEffect(effectIdx).param;
+            }
+            catch (std::exception) { return 0.f; }
+        }
+
+        int32_t GetStaticEffectAux(uint32_t formId, int32_t effectIdx)
+        {
+            try {
+                float time;
+                return GetArousalDataForRead(RequireActor(formId), time)->GetStaticArousalEffect(effectIdx).intAux;
+            }
+            catch (std::exception) { return 0; }
+        }
+
+        void SetDynamicArousalEffect(uint32_t formId, std::string_view effectId, float initialValue, int32_t functionId, float param, float limit)
+        {
+            try {
+                auto data = GetArousalDataForWrite(RequireActor(formId));
+                data->SetDynamicArousalEffect(effectId, initialValue, functionId, param, limit);
+                data.PublishChanges();
+            }
+            catch (std::exception) {}
+        }
+
+        void ModDynamicArousalEffect(uint32_t formId, std::string_view effectId, float modifier, float limit)
+        {
+            try {
+                auto data = GetArousalDataForWrite(RequireActor(formId));
+                data->ModDynamicArousalEffect(effectId, modifier, limit);
+                data.PublishChanges();
+            }
+            catch (std::exception) {}
+        }
+
+        void SetStaticArousalEffect(uint32_t formId, int32_t effectIdx, int32_t functionId, float param, float limit, int32_t auxilliary)
+        {
+            try {
+                auto data = GetArousalDataForWrite(RequireActor(formId));
+                data->SetStaticArousalEffect(effectIdx, functionId, param, limit, auxilliary);
+                data.PublishChanges();
+            }
+            catch (std::exception) {}
+        }
+
+        void SetStaticArousalValue(uint32_t formId, int32_t effectIdx, float value)
+        {
+            try {
+                auto data = GetArousalDataForWrite(RequireActor(formId));
+                data->SetStaticArousalValue(effectIdx, value);
+                data.PublishChanges();
+            }
+            catch (std::exception) {}
+        }
+
+        float ModStaticArousalValue(uint32_t formId, int32_t effectIdx, float diff, float limit)
+        {
+            try {
+                auto data = GetArousalDataForWrite(RequireActor(formId));
+                const float actualDiff = data->ModStaticArousalValue(effectIdx, diff, limit);
+                data.PublishChanges();
+                return actualDiff;
+            }
+            catch (std::exception) { return 0.f; }
+        }
+
+        void SetStaticAuxillaryFloat(uint32_t formId, int32_t effectIdx, float value)
+        {
+            try {
+                GetArousalDataForAux(RequireActor(formId))->SetStaticAuxillaryFloat(effectIdx, value);
+            }
+            catch (std::exception) {}
+        }
+
+        void SetStaticAuxillaryInt(uint32_t formId, int32_t effectIdx, int32_t value)
+        {
+            try {
+                GetArousalDataForAux(RequireActor(formId))->SetStaticAuxillaryInt(effectIdx, value);
+            }
+            catch (std::exception) {}
+        }
+
+        float GetArousal(uint32_t formId)
+        {
+            try {
+                return ReadArousal(RequireActor(formId));
+            }
+            catch (std::exception) { return 0.f; }
+        }
+
+        std::vector<float> GetArousalBatch(std::vector<uint32_t> const& formIds)
+        {
+            std::vector<float> result;
+            result.reserve(formIds.size());
+            for (uint32_t formId : formIds)
+                result.push_back(GetArousal(formId));
+            return result;
+        }
+
+        std::vector<float> GetAllStaticEffectValues(uint32_t formId)
+        {
+            try {
+                float time;
+                auto data = GetArousalDataForRead(RequireActor(formId), time);
+                return data->GetStaticEffectValuesAt(formId, time);
+            }
+            catch (std::exception) { return {}; }
+        }
+
+        std::vector<const char*> GetDynamicEffectNames(uint32_t formId)
+        {
+            std::vector<const char*> result;
+            try {
+                float time;
+                auto data = GetArousalDataForRead(RequireActor(formId), time);
+                const int32_t count = data->GetDynamicEffectCount();
+                result.reserve(count);
+                for (int32_t number = 0; number < count; ++number)
+                    result.push_back(data->GetDynamicEffect(number));
+            }
+            catch (std::exception) {}
+            return result;
+        }
+
+        // String is whatever string type the host has, anything with data()
+        template <typename String>
+        std::vector<float> GetDynamicEffectValues(uint32_t formId, std::vector<String> const& names)
+        {
+            std::vector<float> result(names.size(), 0.f);
+            try {
+                float time;
+                auto data = GetArousalDataForRead(RequireActor(formId), time);
+                for (size_t i = 0; i < names.size(); ++i)
+                    result[i] = data->GetDynamicEffectValueByNameAt(names[i].data(), formId, time);
+            }
+            catch (std::exception) {}
+            return result;
+        }
+
+        bool GroupEffects(uint32_t formId, int32_t idx, int32_t idx2)
+        {
+            try {
+                auto data = GetArousalDataForWrite(RequireActor(formId));
+                const bool grouped = data->GroupEffects(formId, idx, idx2);
+                data.PublishChanges();
+                return grouped;
+            }
+            catch (std::exception) { return false; }
+        }
+
+        bool RemoveEffectGroup(uint32_t formId, int32_t idx)
+        {
+            try {
+                auto data = GetArousalDataForWrite(RequireActor(formId));
+                data->RemoveEffectGroup(idx);
+                data.PublishChanges();
+                return true;
+            }
+            catch (std::exception) { return false; }
+        }
+
+        int32_t CleanUpActors(float lastUpdateBefore)
+        {
+            return static_cast<int32_t>(EraseActorsUpdatedBefore(lastUpdateBefore));
+        }
+
+        // Returns the arousal after the update
+        float UpdateSingleActorArousal(uint32_t formId, float GameDaysPassed)
+        {
+            try {
+                auto data = GetArousalData(RequireActor(formId));
+                data->UpdateSingleActorArousal(formId, GameDaysPassed);
+                data.PublishChanges();
+                return data->GetArousal();
+            }
+            catch (std::exception) { return 0.f; }
+        }
+
+        std::vector<float> UpdateActorsArousal(std::vector<uint32_t> const& formIds, float GameDaysPassed)
+        {
+            std::vector<float> result;
+            result.reserve(formIds.size());
+            for (uint32_t formId : formIds)
+                result.push_back(UpdateSingleActorArousal(formId, GameDaysPassed));
+            return result;
+        }
+
+        int32_t UpdateAllActorsArousal(float GameDaysPassed)
+        {
+            return static_cast<int32_t>(UpdateAllActors(GameDaysPassed));
+        }
+
+        bool IsLazyUpdate()
+        {
+            return lazyUpdate;
+        }
+
+        void SetLazyUpdate(bool enabled)
+        {
+            SetLazyUpdateMode(enabled);
+        }
+
+        std::vector<uint32_t> GetMostArousedActors(int32_t count)
+        {
+            if (count <= 0)
+                return {};
+            return arousalRanking.GetTop(static_cast<uint32_t>(count));
+        }
+
+        std::vector<uint32_t> GetActorsInArousalRange(float minArousal, float maxArousal)
+        {
+            return arousalRanking.GetInRange(minArousal, maxArousal);
+        }
+
+        int32_t CountActorsAboveArousal(float minArousal)
+        {
+            return static_cast<int32_t>(arousalRanking.CountAbove(minArousal));
+        }
+
+        // Regular bool would be enough IF skyrim always uses the same thread for all papyrus scripts, but since I have no idea...
+        std::array<std::atomic_flag, 3> locks;
+
+        bool TryLock(int32_t lock)
+        {
+            if (lock < 0 || lock >= static_cast<int32_t>(locks.size()))
+                return false;
+            if (locks[lock].test_and_set())
+                return false;
+            return true;
+        }
+
+        void Unlock(int32_t lock)
+        {
+            if (lock < 0 || lock >= static_cast<int32_t>(locks.size()))
+                return;
+
+            locks[lock].clear();
+        }
+
+        // Reverting the game forgets every lock
+        void UnlockAll()
+        {
+            for (auto& lock : locks)
+                lock.clear();
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+namespace slaModules
+{
+    // Branch free sine and exp2 for the effect functions. The vector kernels in EffectKernels.h use the
+    // same constants in the same order of operations, so their results are bit identical to these.
+    // SLAMBench checks the errors below against libm and times both against std::pow and the old table.
+    namespace FastMath
+    {
+        // Adding and removing 1.5 * 2^23 rounds to the nearest integer, ties to even, while |x| < 2^22
+        constexpr float kRoundMagic = 12582912.f;
+
+        constexpr float RoundNearest(float x)
+        {
+            return (x + kRoundMagic) - kRoundMagic;
+        }
+
+        constexpr float kInvPi = 0.318309886183790671538f;
+        // Pi in three parts, n times the first two is exact for |n| < 2^13 (Cody-Waite reduction)
+        constexpr float kPiA = 3.140625f;
+        constexpr float kPiB = 9.67502593994140625e-4f;
+        constexpr float kPiC = 1.509957990978376432e-7f;
+
+        // Odd degree 9 polynomial for sin on [-pi/2, pi/2], fitted for minimal absolute error
+        constexpr float kSin1 = -1.666665709608076e-1f;
+        constexpr float kSin2 = 8.333017283598650e-3f;
+        constexpr float kSin3 = -1.980661473460473e-4f;
+        constexpr float kSin4 = 2.600053899073580e-6f;
+
+        // Sine of x with an absolute error below 1.25e-7 for |x| < 8192 pi. Beyond that the range
+        // reduction loses bits and the error grows with |x|, effect angles stay far below it.
+        constexpr float Sin(float x)
+        {
+            const float n = RoundNearest(x * kInvPi);
+            const float r = ((x - n * kPiA) - n * kPiB) - n * kPiC;
+            const float r2 = r * r;
+            const float poly = ((kSin4 * r2 + kSin3) * r2 + kSin2) * r2 + kSin1;
+            const float sine = r + r * r2 * poly;
+            // sin(r + n pi) = (-1)^n sin(r), odd is 0 for even n and +-1 for odd n
+            const float odd = n - 2.f * RoundNearest(n * 0.5f);
+            return sine * (1.f - 2.f * odd * odd);
+        }
+
+        // Degree 6 polynomial for 2^x on [-1/2, 1/2] (Cephes exp2f)
+        constexpr float kExp2[] = { 1.535336188319500e-4f, 1.339887440266574e-3f, 9.618437357674640e-3f,
+            5.550332471162809e-2f, 2.402264791363012e-1f, 6.931472028550421e-1f, 1.f };
+
+        // 2^x with a relative error below 1.1e-7 for x in [-126, 127]. Below that the result is flushed to
+        // zero, from 127.5 on it is infinite. NaNs are propagated.
+        inline float Exp2(float x)
+        {
+            // Same operand order as minps/maxps, a NaN ends up clamped and is put back at the end
+            float clamped = x > -127.f ? x : -127.f;
+            clamped = clamped < 128.f ? clamped : 128.f;
+            const float whole = RoundNearest(clamped);
+            const float fraction = clamped - whole;
+
+            float poly = kExp2[0];
+            for (size_t i = 1; i < std::size(kExp2); ++i)
+                poly = poly * fraction + kExp2[i];
+
+            // whole == 128 yields an infinite exponent, whole == -127 a zero
+            const uint32_t bits = static_cast<uint32_t>(static_cast<int32_t>(whole) + 127) << 23;
+            float scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+            const float result = poly * scale;
+            return x == x ? result : x;
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Serialization.h"
+
+namespace slaModules
+{
+    // Stand-in for SKSE::SerializationInterface that keeps the records in memory.
+    // Form ids resolve to themselves.
+    class MemorySerializationInterface
+    {
+    public:
+        bool OpenRecord(uint32_t type, uint32_t version)
+        {
+            records.push_back({ type, version, {} });
+            return true;
+        }
+
+        bool WriteRecordData(const void* buf, uint32_t length)
+        {
+            if (records.empty())
+                return false;
+            auto& data = records.back().data;
+            data.insert(data.end(), static_cast<const char*>(buf), static_cast<const char*>(buf) + length);
+            ++writeCalls;
+            return true;
+        }
+
+        // Starts reading from the first record again
+        void Rewind()
+        {
+            nextRecord = 0;
+            current = nullptr;
+            readCalls = 0;
+        }
+
+        bool GetNextRecordInfo(uint32_t& type, uint32_t& version, uint32_t& length)
+        {
+            if (nextRecord >= records.size())
+                return false;
+            current = &records[nextRecord++];
+            position = 0;
+            type = current->type;
+            version = current->version;
+            length = static_cast<uint32_t>(current->data.size());
+            return true;
+        }
+
+        uint32_t ReadRecordData(void* buf, uint32_t length)
+        {
+            if (!current)
+                return 0;
+            length = std::min<uint32_t>(length, static_cast<uint32_t>(current->data.size() - position));
+            std::memcpy(buf, current->data.data() + position, length);
+            position += length;
+            ++readCalls;
+            return length;
+        }
+
+        bool ResolveFormID(uint32_t oldFormId, uint32_t& newFormId) const
+        {
+            newFormId = oldFormId;
+            return true;
+        }
+
+        void Clear()
+        {
+            records.clear();
+            Rewind();
+            writeCalls = 0;
+        }
+
+        size_t GetSize() const
+        {
+            size_t size = 0;
+            for (auto const& record : records)
+                size += record.data.size();
+            return size;
+        }
+
+        // Record count, then per record type, version, varint length and data
+        void Serialize(RecordWriter& writer) const
+        {
+            writer.WriteVarint(static_cast<uint32_t>(records.size()));
+            for (auto const& record : records)
+            {
+                writer.Write(record.type);
+                writer.Write(record.version);
+                writer.WriteVarintString({ record.data.data(), record.data.size() });
+            }
+        }
+
+        void Deserialize(RecordReader& reader)
+        {
+            Clear();
+            const uint32_t count = reader.ReadVarint();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const uint32_t type = reader.Read<uint32_t>();
+                const uint32_t version = reader.Read<uint32_t>();
+                const std::string_view data = reader.ReadVarintString();
+                records.push_back({ type, version, { data.begin(), data.end() } });
+            }
+        }
+
+        uint64_t GetWriteCalls() const { return writeCalls; }
+        uint64_t GetReadCalls() const { return readCalls; }
+
+    private:
+        struct Record
+        {
+            uint32_t type;
+            uint32_t version;
+            std::vector<char> data;
+        };
+
+        std::vector<Record> records;
+        size_t nextRecord = 0;
+        Record* current = nullptr;
+        size_t position = 0;
+        uint64_t writeCalls = 0;
+        uint64_t readCalls = 0;
+    };
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Utils.h"
+
+// Set to 0 to compile the natives without any instrumentation
+#ifndef SLAM_NATIVE_STATS
+#define SLAM_NATIVE_STATS 1
+#endif
+
+namespace slaModules
+{
+    // Calls, latencies and actor cache use of a single native. Updated with relaxed atomics from
+    // whatever thread runs the native, one cache line per native so they do not contend.
+    struct alignas(64) NativeStats
+    {
+        // Bucket i counts calls faster than 2^(i + kFirstBucketBits) ns, the last one everything slower
+        static constexpr uint32_t kFirstBucketBits = 8;
+        static constexpr uint32_t kBucketCount = 16;
+
+        explicit NativeStats(const char* name) : name(name) {}
+
+        void Record(uint64_t ns, uint64_t hits, uint64_t misses)
+        {
+            const uint32_t bucket = std::min(BitWidth(ns >> kFirstBucketBits), kBucketCount - 1);
+            calls.fetch_add(1, std::memory_order_relaxed);
+            totalNs.fetch_add(ns, std::memory_order_relaxed);
+            buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            if (hits)
+                cacheHits.fetch_add(hits, std::memory_order_relaxed);
+            if (misses)
+                cacheMisses.fetch_add(misses, std::memory_order_relaxed);
+            uint64_t max = maxNs.load(std::memory_order_relaxed);
+            while (ns > max && !maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+        }
+
+        void Reset()
+        {
+            calls = 0;
+            totalNs = 0;
+            maxNs = 0;
+            cacheHits = 0;
+            cacheMisses = 0;
+            for (auto& bucket : buckets)
+                bucket = 0;
+        }
+
+        // Upper bound of the bucket holding the given fraction of the calls
+        double GetPercentileUs(double fraction) const
+        {
+            const uint64_t count = calls.load(std::memory_order_relaxed);
+            uint64_t seen = 0;
+            for (uint32_t i = 0; i < kBucketCount - 1; ++i)
+            {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (seen >= count * fraction)
+                    return static_cast<double>(1ull << (i + kFirstBucketBits)) / 1000.0;
+            }
+            return maxNs.load(std::memory_order_relaxed) / 1000.0;
+        }
+
+        std::string Format() const
+        {
+            const uint64_t count = calls.load(std::memory_order_relaxed);
+            const uint64_t hits = cacheHits.load(std::memory_order_relaxed);
+            const uint64_t lookups = hits + cacheMisses.load(std::memory_order_relaxed);
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s: %llu calls, avg %.2fus, p50 <%.2fus, p99 <%.2fus, max %.2fus, cache %llu/%llu hits",
+                name, static_cast<unsigned long long>(count), count ? totalNs.load(std::memory_order_relaxed) / 1000.0 / count : 0.0,
+                GetPercentileUs(0.5), GetPercentileUs(0.99), maxNs.load(std::memory_order_relaxed) / 1000.0,
+                static_cast<unsigned long long>(hits), static_cast<unsigned long long>(lookups));
+            return line;
+        }
+
+        const char* name;
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> totalNs{ 0 };
+        std::atomic<uint64_t> maxNs{ 0 };
+        std::atomic<uint64_t> cacheHits{ 0 };
+        std::atomic<uint64_t> cacheMisses{ 0 };
+        std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+    };
+
+    // Entries never move, the natives keep pointers to theirs
+    class NativeStatsTable
+    {
+    public:
+        // Registering the same name again returns the existing entry
+        NativeStats& Add(const char* name)
+        {
+            for (auto& entry : entries)
+            {
+                if (std::strcmp(entry.name, name) == 0)
+                    return entry;
+            }
+            return entries.emplace_back(name);
+        }
+
+        void Reset()
+        {
+            for (auto& entry : entries)
+                entry.Reset();
+        }
+
+        // One line per native that was called at least once, busiest first
+        std::vector<std::string> Format() const
+        {
+            std::vector<NativeStats const*> called;
+            for (auto const& entry : entries)
+            {
+                if (entry.calls.load(std::memory_order_relaxed))
+                    called.push_back(&entry);
+            }
+            std::sort(called.begin(), called.end(), [](NativeStats const* a, NativeStats const* b) {
+                return a->calls.load(std::memory_order_relaxed) > b->calls.load(std::memory_order_relaxed);
+            });
+
+            std::vector<std::string> lines;
+            lines.reserve(called.size());
+            for (NativeStats const* entry : called)
+                lines.push_back(entry->Format());
+            return lines;
+        }
+
+    private:
+        std::deque<NativeStats> entries;
+    };
+
+    NativeStatsTable nativeStats;
+
+    // Times one native call and attributes the actor cache lookups made on this thread meanwhile
+    template <typename Cache>
+    class NativeScope
+    {
+    public:
+        NativeScope(NativeStats& stats, Cache const& cache) :
+            stats(stats), cache(cache), hits(cache.GetHits()), misses(cache.GetMisses()), start(std::chrono::steady_clock::now())
+        {}
+
+        ~NativeScope()
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            stats.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                cache.GetHits() - hits, cache.GetMisses() - misses);
+        }
+
+        NativeScope(NativeScope const&) = delete;
+        NativeScope& operator=(NativeScope const&) = delete;
+
+    private:
+        NativeStats& stats;
+        Cache const& cache;
+        const uint64_t hits;
+        const uint64_t misses;
+        const std::chrono::steady_clock::time_point start;
+    };
+}
@@ -3,8 +3,7 @@
 #include "SKSE/SKSE.h"
 #include "RE/Skyrim.h"
 
-#include <random>
-#include <unordered_set>
+#include "CorePCH.h"
 
 #ifndef NDEBUG
 #include <spdlog/sinks/msvc_sink.h>
@@ -1,320 +1,319 @@
 #pragma once
 
-#include "Arousal.h"
-#include "Serialization.h"
+#include "Engine.h"
+#include "NativeStats.h"
+#include "Trace.h"
+#include "UpdateScheduler.h"
 
 using VM = RE::BSScript::IVirtualMachine;
 
 namespace slaModules
 {
-    uint32_t lastLookup;
-    ArousalData* lastData = nullptr;
-    std::unordered_map<uint32_t, ArousalData> arousalData;
+    // The bodies are in Engine.h, shared with the replay. These only resolve actors and the calendar.
 
-    uint32_t GetStaticEffectCount(RE::StaticFunctionTag*)
+    uint32_t GetFormId(RE::Actor* who)
     {
-        return staticEffectCount;
+        return who ? who->formID : 0;
     }
 
-    std::string GetUnusedEffectId(int32_t id)
+    std::vector<uint32_t> GetFormIds(std::vector<RE::Actor*> const& actors)
     {
-        return "Unused" + std::to_string(id);
+        std::vector<uint32_t> result;
+        result.reserve(actors.size());
+        for (RE::Actor* who : actors)
+            result.push_back(GetFormId(who));
+        return result;
     }
 
-    int32_t GetHighestUnusedEffectId()
+    // Forms that no longer exist are left out
+    std::vector<RE::Actor*> LookupActors(std::vector<uint32_t> const& formIds)
     {
-        int32_t result = -1;
-        while (staticEffectIds.find(GetUnusedEffectId(result + 1)) != staticEffectIds.end())
-            result += 1;
+        std::vector<RE::Actor*> result;
+        result.reserve(formIds.size());
+        for (uint32_t formId : formIds)
+        {
+            if (RE::Actor* actor = dynamic_cast<RE::Actor*>(RE::TESForm::LookupByID(formId)))
+                result.push_back(actor);
+        }
         return result;
     }
 
-    uint32_t RegisterStaticEffect(RE::StaticFunctionTag*, RE::BSFixedString name)
+    float GetCurrentGameTime()
     {
-        auto itr = staticEffectIds.find(name.data());
-        if (itr != staticEffectIds.end())
-            return itr->second;
-
-        int32_t unusedId = GetHighestUnusedEffectId();
-        if (unusedId != -1)
-        {
-            itr = staticEffectIds.find(GetUnusedEffectId(unusedId));
-            assert(itr != staticEffectIds.end());
-            uint32_t effectId = itr->second;
-            staticEffectIds.erase(itr);
-            staticEffectIds[name.data()] = effectId;
-            return effectId;
-        }
+        return RE::Calendar::GetSingleton()->GetDaysPassed();
+    }
 
-        staticEffectIds[name.data()] = staticEffectCount;
-        for (auto& data : arousalData)
-            data.second.OnRegisterStaticEffect();
-        const auto result = staticEffectCount;
-        staticEffectCount++;
-        return result;
+    uint32_t GetStaticEffectCount(RE::StaticFunctionTag*)
+    {
+        return Natives::GetStaticEffectCount();
     }
 
-    bool UnregisterStaticEffect(RE::StaticFunctionTag*, RE::BSFixedString name)
+    uint32_t RegisterStaticEffect(RE::StaticFunctionTag*, RE::BSFixedString name)
     {
-        auto itr = staticEffectIds.find(name.data());
-        if (itr != staticEffectIds.end())
-        {
-            uint32_t id = itr->second;
-            staticEffectIds.erase(itr);
-            int32_t unusedId = GetHighestUnusedEffectId();
-            staticEffectIds[GetUnusedEffectId(unusedId + 1)] = id;
-            for (auto& data : arousalData)
-                data.second.OnUnregisterStaticEffect(id);
-            return true;
-        }
-        return false;
+        return Natives::RegisterStaticEffect(name.data());
     }
 
-    ArousalData& _GetOrCreateArousalData(uint32_t formId)
+    bool UnregisterStaticEffect(RE::StaticFunctionTag*, RE::BSFixedString name)
     {
-        if (lastLookup == formId && lastData)
-            return *lastData;
-        auto& result = arousalData[formId];
-        lastLookup = formId;
-        lastData = &result;
-        return result;
+        return Natives::UnregisterStaticEffect(name.data());
     }
 
-    ArousalData& GetArousalData(RE::Actor* who)
+    // Returns the effect function to pass to SetStaticArousalEffect/SetDynamicArousalEffect, 0 if the
+    // points are invalid. Registering a name again replaces its curve and keeps the function.
+    int32_t RegisterEffectCurve(RE::StaticFunctionTag*, RE::BSFixedString name, std::vector<float> xs, std::vector<float> ys)
     {
-        if (!who)
-            throw std::invalid_argument("Attempt to get arousal data for none actor");
-        return _GetOrCreateArousalData(who->formID);
+        return Natives::RegisterEffectCurve(name.data(), std::move(xs), std::move(ys));
     }
 
-    ArousalEffectData& GetStaticArousalEffect(RE::Actor* who, int32_t effectIdx)
+    int32_t GetEffectCurveFunction(RE::StaticFunctionTag*, RE::BSFixedString name)
     {
-        ArousalData& data = GetArousalData(who);
-        return data.GetStaticArousalEffect(effectIdx);
+        return Natives::GetEffectCurveFunction(name.data());
     }
 
     int32_t GetDynamicEffectCount(RE::StaticFunctionTag*, RE::Actor* who)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            return data.GetDynamicEffectCount();
-        }
-        catch (std::exception) { return 0; }
+        return Natives::GetDynamicEffectCount(GetFormId(who));
     }
 
     RE::BSFixedString GetDynamicEffect(RE::StaticFunctionTag*, RE::Actor* who, int32_t number)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            return data.GetDynamicEffect(number);
-        }
-        catch (std::exception) { return ""; }
+        return Natives::GetDynamicEffect(GetFormId(who), number);
     }
 
     float GetDynamicEffectValueByName(RE::StaticFunctionTag*, RE::Actor* who, RE::BSFixedString effectId)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            return data.GetDynamicEffectValueByName(effectId);
-        }
-        catch (std::exception) { return 0.0; }
+        return Natives::GetDynamicEffectValueByName(GetFormId(who), effectId.data());
     }
 
     float GetDynamicEffectValue(RE::StaticFunctionTag*, RE::Actor* who, int32_t number)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            return data.GetDynamicEffectValue(number);
-        }
-        catch (std::exception) { return std::numeric_limits<float>::lowest(); }
+        return Natives::GetDynamicEffectValue(GetFormId(who), number);
     }
 
     bool IsStaticEffectActive(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            return data.IsStaticEffectActive(effectIdx);
-        }
-        catch (std::exception) { return false; }
+        return Natives::IsStaticEffectActive(GetFormId(who), effectIdx);
     }
 
     float GetStaticEffectValue(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            if (auto group = data.GetEffectGroup(effectIdx))
-                return group->value;
-            ArousalEffectData& effect = data.GetStaticArousalEffect(effectIdx);
-            return effect.value;
-        }
-        catch (std::exception) { return 0.f; }
+        return Natives::GetStaticEffectValue(GetFormId(who), effectIdx);
     }
 
     float GetStaticEffectParam(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx)
     {
-        try {
-            ArousalEffectData& effect = GetStaticArousalEffect(who, effectIdx);
-            return effect.param;
-        }
-        catch (std::exception) { return 0.f; }
+        return Natives::GetStaticEffectParam(GetFormId(who), effectIdx);
     }
 
     int32_t GetStaticEffectAux(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx)
     {
-        try {
-            ArousalEffectData& effect = GetStaticArousalEffect(who, effectIdx);
-            return effect.intAux;
-        }
-        catch (std::exception) { return 0; }
+        return Natives::GetStaticEffectAux(GetFormId(who), effectIdx);
     }
 
     void SetDynamicArousalEffect(RE::StaticFunctionTag*, RE::Actor* who, RE::BSFixedString effectId, float initialValue, int32_t functionId, float param, float limit)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            data.SetDynamicArousalEffect(effectId, initialValue, functionId, param, limit);
-        }
-        catch (std::exception) {}
+        Natives::SetDynamicArousalEffect(GetFormId(who), effectId.data(), initialValue, functionId, param, limit);
     }
 
     void ModDynamicArousalEffect(RE::StaticFunctionTag*, RE::Actor* who, RE::BSFixedString effectId, float modifier, float limit)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            data.ModDynamicArousalEffect(effectId, modifier, limit);
-        }
-        catch (std::exception) {}
+        Natives::ModDynamicArousalEffect(GetFormId(who), effectId.data(), modifier, limit);
     }
 
     void SetStaticArousalEffect(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx, int32_t functionId, float param, float limit, int32_t auxilliary)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            data.SetStaticArousalEffect(effectIdx, functionId, param, limit, auxilliary);
-        }
-        catch (std::exception) {}
+        Natives::SetStaticArousalEffect(GetFormId(who), effectIdx, functionId, param, limit, auxilliary);
     }
 
     void SetStaticArousalValue(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx, float value)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            data.SetStaticArousalValue(effectIdx, value);
-        }
-        catch (std::exception) {}
+        Natives::SetStaticArousalValue(GetFormId(who), effectIdx, value);
     }
 
     float ModStaticArousalValue(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx, float diff, float limit)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            return data.ModStaticArousalValue(effectIdx, diff, limit);
-        }
-        catch (std::exception) { return 0.f; }
+        return Natives::ModStaticArousalValue(GetFormId(who), effectIdx, diff, limit);
     }
 
     void SetStaticAuxillaryFloat(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx, float value)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            ArousalEffectData& effect = data.GetStaticArousalEffect(effectIdx);
-
-            effect.floatAux = value;
-        }
-        catch (std::exception) {}
+        Natives::SetStaticAuxillaryFloat(GetFormId(who), effectIdx, value);
     }
 
     void SetStaticAuxillaryInt(RE::StaticFunctionTag*, RE::Actor* who, int32_t effectIdx, int32_t value)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            ArousalEffectData& effect = data.GetStaticArousalEffect(effectIdx);
-
-            effect.intAux = value;
-        }
-        catch (std::exception) {}
+        Natives::SetStaticAuxillaryInt(GetFormId(who), effectIdx, value);
     }
 
     float GetArousal(RE::StaticFunctionTag*, RE::Actor* who)
     {
-        try {
-            return GetArousalData(who).GetArousal();
-        }
-        catch (std::exception) { return 0.f; }
+        return Natives::GetArousal(GetFormId(who));
+    }
+
+    // Bulk reads for widgets that show many values at once. Every actor is looked up once and each
+    // native returns one array, values of actors that can not be read fall back like the single natives.
+
+    std::vector<float> GetArousalBatch(RE::StaticFunctionTag*, std::vector<RE::Actor*> actors)
+    {
+        return Natives::GetArousalBatch(GetFormIds(actors));
+    }
+
+    // GetStaticEffectValue of every effect index
+    std::vector<float> GetAllStaticEffectValues(RE::StaticFunctionTag*, RE::Actor* who)
+    {
+        return Natives::GetAllStaticEffectValues(GetFormId(who));
+    }
+
+    // Names of the dynamic effects in the order of GetDynamicEffect. Papyrus natives return a single
+    // array, GetDynamicEffectValues completes the snapshot for exactly these names.
+    std::vector<RE::BSFixedString> GetDynamicEffectNames(RE::StaticFunctionTag*, RE::Actor* who)
+    {
+        const auto names = Natives::GetDynamicEffectNames(GetFormId(who));
+        return std::vector<RE::BSFixedString>(names.begin(), names.end());
+    }
+
+    // GetDynamicEffectValueByName of every name, 0 for effects the actor no longer has
+    std::vector<float> GetDynamicEffectValues(RE::StaticFunctionTag*, RE::Actor* who, std::vector<RE::BSFixedString> names)
+    {
+        return Natives::GetDynamicEffectValues(GetFormId(who), names);
     }
 
     bool GroupEffects(RE::StaticFunctionTag*, RE::Actor* who, int32_t idx, int32_t idx2)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            return data.GroupEffects(who, idx, idx2);
-        }
-        catch (std::exception) { return false; }
+        return Natives::GroupEffects(GetFormId(who), idx, idx2);
     }
 
     bool RemoveEffectGroup(RE::StaticFunctionTag*, RE::Actor* who, int32_t idx)
     {
-        try {
-            ArousalData& data = GetArousalData(who);
-            data.RemoveEffectGroup(idx);
-            return true;
-        }
-        catch (std::exception) { return false; }
+        return Natives::RemoveEffectGroup(GetFormId(who), idx);
     }
 
     int32_t CleanUpActors(RE::StaticFunctionTag*, float lastUpdateBefore)
     {
-        int32_t removed = 0;
-        for (auto itr = arousalData.begin(); itr != arousalData.end();)
-        {
-            if (itr->second.GetLastUpdate() < lastUpdateBefore)
-            {
-                itr = arousalData.erase(itr);
-                ++removed;
-            }
-            else
-                ++itr;
-        }
-        return removed;
+        return Natives::CleanUpActors(lastUpdateBefore);
     }
 
     void UpdateSingleActorArousal(RE::StaticFunctionTag*, RE::Actor* who, float GameDaysPassed)
     {
-        try
-        {
-            ArousalData& data = GetArousalData(who);
-            data.UpdateSingleActorArousal(who, GameDaysPassed);
-        }
-        catch (std::exception) {}
+        Natives::UpdateSingleActorArousal(GetFormId(who), GameDaysPassed);
+    }
+
+    std::vector<float> UpdateActorsArousal(RE::StaticFunctionTag*, std::vector<RE::Actor*> actors, float GameDaysPassed)
+    {
+        return Natives::UpdateActorsArousal(GetFormIds(actors), GameDaysPassed);
+    }
+
+    int32_t UpdateAllActorsArousal(RE::StaticFunctionTag*, float GameDaysPassed)
+    {
+        return Natives::UpdateAllActorsArousal(GameDaysPassed);
+    }
+
+    bool IsLazyUpdate(RE::StaticFunctionTag*)
+    {
+        return Natives::IsLazyUpdate();
+    }
+
+    void SetLazyUpdate(RE::StaticFunctionTag*, bool enabled)
+    {
+        Natives::SetLazyUpdate(enabled);
+    }
+
+    int32_t GetUpdateThreadCount(RE::StaticFunctionTag*)
+    {
+        return static_cast<int32_t>(UpdatePool::GetSingleton().GetThreadCount());
+    }
+
+    void SetUpdateThreadCount(RE::StaticFunctionTag*, int32_t count)
+    {
+        if (count <= 0)
+            count = static_cast<int32_t>(std::thread::hardware_concurrency());
+        UpdatePool::GetSingleton().SetThreadCount(static_cast<uint32_t>(count));
+    }
+
+    // The scheduler thread must not read the calendar while the game runs, the main thread hands the
+    // time over between frames. One request at a time, slices in between use the last time.
+    std::atomic<bool> gameTimeRequested{ false };
+
+    void RequestGameTime()
+    {
+        if (gameTimeRequested.exchange(true))
+            return;
+        SKSE::GetTaskInterface()->AddTask([] {
+            gameTimeRequested = false;
+            UpdateScheduler::GetSingleton().SetGameTime(RE::Calendar::GetSingleton()->GetDaysPassed());
+        });
+    }
+
+    // Takes the update cadence over from the scripts. The slices run on the scheduler thread with the
+    // game time RequestGameTime provides.
+    bool StartUpdateScheduler(RE::StaticFunctionTag*, int32_t sliceBudgetUs, int32_t sliceIntervalMs)
+    {
+        if (sliceBudgetUs <= 0 || sliceIntervalMs <= 0)
+            return false;
+        UpdateScheduler::GetSingleton().SetGameTime(GetCurrentGameTime());
+        UpdateScheduler::GetSingleton().Start(std::chrono::microseconds(sliceBudgetUs), std::chrono::milliseconds(sliceIntervalMs));
+        logger::info("Update scheduler running slices of {}us every {}ms", sliceBudgetUs, sliceIntervalMs);
+        return true;
+    }
+
+    void StopUpdateScheduler(RE::StaticFunctionTag*)
+    {
+        UpdateScheduler::GetSingleton().Stop();
+    }
+
+    bool IsUpdateSchedulerRunning(RE::StaticFunctionTag*)
+    {
+        return UpdateScheduler::GetSingleton().IsRunning();
+    }
+
+    RE::BSFixedString GetUpdateSchedulerStats(RE::StaticFunctionTag*, bool reset)
+    {
+        SliceStats& stats = UpdateScheduler::GetSingleton().GetStats();
+        RE::BSFixedString result(stats.Format());
+        if (reset)
+            stats.Reset();
+        return result;
     }
 
     std::vector<RE::Actor*> GetActorList(RE::StaticFunctionTag*)
     {
         std::vector<RE::Actor*> result;
-        for (auto& entry : arousalData)
-            if (RE::Actor* actor = dynamic_cast<RE::Actor*>(RE::TESForm::LookupByID(entry.first)))
+        arousalData.ForEach([&result](uint32_t formId, ArousalData&) {
+            if (RE::Actor* actor = dynamic_cast<RE::Actor*>(RE::TESForm::LookupByID(formId)))
                 result.push_back(actor);
+        });
         return result;
     }
 
-    // Regular bool would be enough IF skyrim always uses the same thread for all papyrus scripts, but since I have no idea...
-    std::array<std::atomic_flag, 3> locks;
+    // Queries on arousalRanking instead of GetActorList and a GetArousal per actor. Actors are
+    // ordered by the arousal of their last update, highest first, and forms that no longer exist are
+    // left out of the result.
+
+    std::vector<RE::Actor*> GetMostArousedActors(RE::StaticFunctionTag*, int32_t count)
+    {
+        return LookupActors(Natives::GetMostArousedActors(count));
+    }
+
+    // Actors with an arousal within [minArousal, maxArousal]
+    std::vector<RE::Actor*> GetActorsInArousalRange(RE::StaticFunctionTag*, float minArousal, float maxArousal)
+    {
+        return LookupActors(Natives::GetActorsInArousalRange(minArousal, maxArousal));
+    }
+
+    // Actors with an arousal of at least minArousal
+    int32_t CountActorsAboveArousal(RE::StaticFunctionTag*, float minArousal)
+    {
+        return Natives::CountActorsAboveArousal(minArousal);
+    }
 
     bool TryLock(RE::StaticFunctionTag*, int32_t lock)
     {
-        if (lock < 0 || lock >= locks.size())
-            return false;
-        if (locks[lock].test_and_set())
-            return false;
-        return true;
+        return Natives::TryLock(lock);
     }
 
     void Unlock(RE::StaticFunctionTag*, int32_t lock)
     {
-        if (lock < 0 || lock >= locks.size())
-            return;
-
-        locks[lock].clear();
+        Natives::Unlock(lock);
     }
 
     std::vector<RE::Actor*> DuplicateActorArray(RE::StaticFunctionTag*, std::vector<RE::Actor*> arr, int32_t count)
@@ -327,153 +326,249 @@ namespace slaModules
         return result;
     }
 
-    const uint32_t kSerializationDataVersion = 1;
+    std::vector<RE::BSFixedString> GetNativeStats(RE::StaticFunctionTag*)
+    {
+        std::vector<RE::BSFixedString> result;
+        for (auto const& line : nativeStats.Format())
+            result.emplace_back(line);
+        return result;
+    }
 
-    void Serialization_Revert(SKSE::SerializationInterface*)
+    void DumpNativeStats(RE::StaticFunctionTag*, bool reset)
     {
-        logger::info("revert");
+#if SLAM_NATIVE_STATS
+        logger::info("Native stats:");
+        for (auto const& line : nativeStats.Format())
+            logger::info("  {}", line);
+        if (reset)
+            nativeStats.Reset();
+#else
+        logger::info("Native stats are not compiled in");
+#endif
+    }
+
+    // Records every native call to fileName in the SKSE log directory, starting from the current state
+    bool StartNativeTrace(RE::StaticFunctionTag*, RE::BSFixedString fileName)
+    {
+#if SLAM_NATIVE_TRACE
+        auto path = logger::log_directory();
+        if (!path || fileName.empty())
+            return false;
+        *path /= fileName.data();
+
+        // A second trace fails anyway, and while recording this runs in Trace with the call lock held
+        if (nativeTrace.IsRecording())
+            return false;
+        auto order = nativeTrace.LockExclusive();
+        MemorySerializationInterface snapshot;
+        RecordWriter writer;
+        SaveData(&snapshot, writer);
+        if (!nativeTrace.Start(path->string(), updateJitterSeed, lazyUpdate, UpdateScheduler::GetSingleton().IsRunning(), snapshot))
+            return false;
+        logger::info("Recording native calls to {}", path->string());
+        return true;
+#else
+        return false;
+#endif
+    }
 
-        staticEffectCount = 0;
-        staticEffectIds.clear();
+    int32_t StopNativeTrace(RE::StaticFunctionTag*)
+    {
+        const uint64_t calls = nativeTrace.Stop();
+        if (calls)
+            logger::info("Recorded {} native calls", calls);
+        return static_cast<int32_t>(std::min<uint64_t>(calls, std::numeric_limits<int32_t>::max()));
+    }
 
-        lastLookup = 0;
-        lastData = nullptr;
-        arousalData.clear();
+    void Serialization_Revert(SKSE::SerializationInterface*)
+    {
+        logger::info("revert");
 
-        for (auto& lock : locks)
-            lock.clear();
+        UpdateScheduler::GetSingleton().Pause();
+        RevertData();
+        nativeTrace.AppendRevert();
+        Natives::UnlockAll();
     }
 
     void Serialization_Load(SKSE::SerializationInterface* intfc)
     {
         logger::info("load");
+        LoadData(intfc);
 
-        uint32_t type;
-        uint32_t version;
-        uint32_t length;
-        bool error = false;
-
-        while (!error && intfc->GetNextRecordInfo(type, version, length))
+        // A replay can not read the co-save, it starts over from the loaded state. Natives on the VM
+        // threads wait for the snapshot, the scheduler is still paused and its slices resume after it.
+        if (nativeTrace.IsRecording())
         {
-            switch (type)
-            {
-            case 'DATA':
-            {
-                if (version == kSerializationDataVersion)
-                {
-                    logger::info("Version correct");
-                    try
-                    {
-                        staticEffectCount = ReadDataHelper<uint32_t>(intfc, length);
-                        logger::info("Loading {} effects... ", staticEffectCount);
-
-                        for (uint32_t i = 0; i < staticEffectCount; ++i)
-                        {
-                            std::string effect = ReadString(intfc, length);
-                            uint32_t id = ReadDataHelper<uint32_t>(intfc, length);
-                            staticEffectIds[effect] = id;
-                            // logger::info("Added effect '{}' with id {}", effect.c_str(), id);
-                        }
-
-                        uint32_t entryCount = ReadDataHelper<uint32_t>(intfc, length);
-                        logger::info("Loading {} data sets... ", entryCount);
-
-                        for (uint32_t i = 0; i < entryCount; ++i)
-                        {
-                            uint32_t formId = ReadDataHelper<uint32_t>(intfc, length);
-                            // logger::info("Loading data for actor {}...", formId);
-                            ArousalData data(intfc, length);
-                            uint32_t newFormId;
-                            if (!intfc->ResolveFormID(formId, newFormId))
-                                continue;
-                            arousalData[newFormId] = std::move(data);
-                        }
-                    }
-                    catch (std::exception)
-                    {
-                        error = true;
-                    }
-                }
-                else
-                    error = true;
-            }
-            break;
-
-            default:
-                logger::info("unhandled type {}", type);
-                error = true;
-                break;
-            }
+            auto order = nativeTrace.LockExclusive();
+            MemorySerializationInterface snapshot;
+            SaveData(&snapshot, recordWriter);
+            nativeTrace.AppendSnapshot(lazyUpdate, UpdateScheduler::GetSingleton().IsPaused(), snapshot);
         }
 
-        if (error)
-            logger::info("Encountered error while loading data");
+        UpdateScheduler::GetSingleton().Resume();
     }
 
     void Serialization_Save(SKSE::SerializationInterface* intfc)
     {
         logger::info("save");
+        SaveData(intfc, recordWriter);
+    }
+
+    static constexpr char CLASS_NAME[] = "slaInternalModules";
 
-        if (intfc->OpenRecord('DATA', kSerializationDataVersion))
+    void TraceValue(RecordWriter&, RE::StaticFunctionTag*) {}
+    void TraceValue(RecordWriter& writer, RE::Actor* who) { writer.WriteVarint(who ? who->formID : 0); }
+    void TraceValue(RecordWriter& writer, int32_t value) { writer.WriteSignedVarint(value); }
+    void TraceValue(RecordWriter& writer, uint32_t value) { writer.WriteVarint(value); }
+    void TraceValue(RecordWriter& writer, float value) { writer.Write(value); }
+    void TraceValue(RecordWriter& writer, bool value) { writer.Write<uint8_t>(value); }
+    void TraceValue(RecordWriter& writer, RE::BSFixedString const& value) { writer.WriteVarintString(value.empty() ? "" : value.data()); }
+
+    template <typename Ty>
+    void TraceValue(RecordWriter& writer, std::vector<Ty> const& values)
+    {
+        writer.WriteVarint(static_cast<uint32_t>(values.size()));
+        for (auto const& value : values)
+            TraceValue(writer, value);
+    }
+
+#if SLAM_NATIVE_STATS || SLAM_NATIVE_TRACE
+    template <auto Fn>
+    struct Instrumented;
+
+    // Call has the signature of Fn, so the VM binds it exactly like the plain native
+    template <typename R, typename... Args, R (*Fn)(Args...)>
+    struct Instrumented<Fn>
+    {
+        static inline NativeStats* stats = nullptr;
+        static inline uint32_t traceId = 0;
+
+        static R Call(Args... args)
+        {
+#if SLAM_NATIVE_TRACE
+            if (nativeTrace.IsRecording())
+                return Trace(args...);
+#endif
+            return Invoke(args...);
+        }
+
+    private:
+        static R Invoke(Args&... args)
+        {
+#if SLAM_NATIVE_STATS
+            NativeScope scope(*stats, actorCache);
+#endif
+            return Fn(std::forward<Args>(args)...);
+        }
+
+        // Arguments are written before the call, Fn may consume them
+        static R Trace(Args&... args)
         {
-            intfc->WriteRecordData(&staticEffectCount, sizeof(staticEffectCount));
-            for (auto const& kvp : staticEffectIds)
+            auto order = nativeTrace.LockCall();
+            thread_local RecordWriter event;
+            event.Clear();
+            event.Write(TraceEvent::Call);
+            event.WriteVarint(traceId);
+            event.Write(currentGameTime());
+            (TraceValue(event, args), ...);
+            if constexpr (std::is_void_v<R>)
             {
-                WriteString(intfc, kvp.first);
-                int32_t id = kvp.second;
-                intfc->WriteRecordData(&id, sizeof(id));
+                Invoke(args...);
+                nativeTrace.AppendCall(event);
             }
-            uint32_t entryCount = static_cast<uint32_t>(arousalData.size());
-            intfc->WriteRecordData(&entryCount, sizeof(entryCount));
-            for (auto const& entry : arousalData)
+            else
             {
-                ArousalData const& data = entry.second;
-                uint32_t formId = entry.first;
-                intfc->WriteRecordData(&formId, sizeof(formId));
-                data.Serialize(intfc);
+                R result = Invoke(args...);
+                TraceValue(event, result);
+                nativeTrace.AppendCall(event);
+                return result;
             }
         }
-    }
+    };
+#endif
 
-    static constexpr char CLASS_NAME[] = "slaInternalModules";
+    template <auto Fn>
+    void RegisterNative(VM* a_vm, const char* name, bool callableFromTasklets = false)
+    {
+#if SLAM_NATIVE_STATS || SLAM_NATIVE_TRACE
+        Instrumented<Fn>::stats = &nativeStats.Add(name);
+        Instrumented<Fn>::traceId = nativeTrace.AddNative(name);
+        a_vm->RegisterFunction(name, CLASS_NAME, Instrumented<Fn>::Call, callableFromTasklets);
+#else
+        a_vm->RegisterFunction(name, CLASS_NAME, Fn, callableFromTasklets);
+#endif
+    }
 
     bool RegisterFuncs(VM* a_vm)
     {
-        BuildSinCosTable();
-
-        a_vm->RegisterFunction("GetStaticEffectCount", CLASS_NAME, GetStaticEffectCount);
-        a_vm->RegisterFunction("RegisterStaticEffect", CLASS_NAME, RegisterStaticEffect);
-        a_vm->RegisterFunction("UnregisterStaticEffect", CLASS_NAME, UnregisterStaticEffect);
-        a_vm->RegisterFunction("IsStaticEffectActive", CLASS_NAME, IsStaticEffectActive);
-        a_vm->RegisterFunction("GetDynamicEffectCount", CLASS_NAME, GetDynamicEffectCount);
-        a_vm->RegisterFunction("GetDynamicEffect", CLASS_NAME, GetDynamicEffect);
-        a_vm->RegisterFunction("GetDynamicEffectValueByName", CLASS_NAME, GetDynamicEffectValueByName);
-        a_vm->RegisterFunction("GetDynamicEffectValue", CLASS_NAME, GetDynamicEffectValue);
-        a_vm->RegisterFunction("GetStaticEffectValue", CLASS_NAME, GetStaticEffectValue);
-        a_vm->RegisterFunction("GetStaticEffectParam", CLASS_NAME, GetStaticEffectParam);
-        a_vm->RegisterFunction("GetStaticEffectAux", CLASS_NAME, GetStaticEffectAux);
-        a_vm->RegisterFunction("SetStaticArousalEffect", CLASS_NAME, SetStaticArousalEffect);
-        a_vm->RegisterFunction("SetDynamicArousalEffect", CLASS_NAME, SetDynamicArousalEffect);
-        a_vm->RegisterFunction("ModDynamicArousalEffect", CLASS_NAME, ModDynamicArousalEffect);
-        a_vm->RegisterFunction("SetStaticArousalValue", CLASS_NAME, SetStaticArousalValue);
-        a_vm->RegisterFunction("SetStaticAuxillaryFloat", CLASS_NAME, SetStaticAuxillaryFloat);
-        a_vm->RegisterFunction("SetStaticAuxillaryInt", CLASS_NAME, SetStaticAuxillaryInt);
-        a_vm->RegisterFunction("ModStaticArousalValue", CLASS_NAME, ModStaticArousalValue);
-        a_vm->RegisterFunction("GetArousal", CLASS_NAME, GetArousal);
-        a_vm->RegisterFunction("UpdateSingleActorArousal", CLASS_NAME, UpdateSingleActorArousal);
-
-        a_vm->RegisterFunction("GroupEffects", CLASS_NAME, GroupEffects);
-        a_vm->RegisterFunction("RemoveEffectGroup", CLASS_NAME, RemoveEffectGroup);
-
-        a_vm->RegisterFunction("CleanUpActors", CLASS_NAME, CleanUpActors);
-
-        a_vm->RegisterFunction("TryLock", CLASS_NAME, TryLock, true);
-        a_vm->RegisterFunction("Unlock", CLASS_NAME, Unlock, true);
-        a_vm->RegisterFunction("DuplicateActorArray", CLASS_NAME, DuplicateActorArray, true);
+        currentGameTime = GetCurrentGameTime;
+        UpdateScheduler::requestGameTime = RequestGameTime;
+        updateJitterSeed = std::random_device{}();
+        logger::info("Using {} effect kernels", effectKernels->name);
+
+        RegisterNative<GetStaticEffectCount>(a_vm, "GetStaticEffectCount");
+        RegisterNative<RegisterStaticEffect>(a_vm, "RegisterStaticEffect");
+        RegisterNative<UnregisterStaticEffect>(a_vm, "UnregisterStaticEffect");
+        RegisterNative<RegisterEffectCurve>(a_vm, "RegisterEffectCurve");
+        RegisterNative<GetEffectCurveFunction>(a_vm, "GetEffectCurveFunction");
+        RegisterNative<IsStaticEffectActive>(a_vm, "IsStaticEffectActive");
+        RegisterNative<GetDynamicEffectCount>(a_vm, "GetDynamicEffectCount");
+        RegisterNative<GetDynamicEffect>(a_vm, "GetDynamicEffect");
+        RegisterNative<GetDynamicEffectValueByName>(a_vm, "GetDynamicEffectValueByName");
+        RegisterNative<GetDynamicEffectValue>(a_vm, "GetDynamicEffectValue");
+        RegisterNative<GetStaticEffectValue>(a_vm, "GetStaticEffectValue");
+        RegisterNative<GetStaticEffectParam>(a_vm, "GetStaticEffectParam");
+        RegisterNative<GetStaticEffectAux>(a_vm, "GetStaticEffectAux");
+        RegisterNative<SetStaticArousalEffect>(a_vm, "SetStaticArousalEffect");
+        RegisterNative<SetDynamicArousalEffect>(a_vm, "SetDynamicArousalEffect");
+        RegisterNative<ModDynamicArousalEffect>(a_vm, "ModDynamicArousalEffect");
+        RegisterNative<SetStaticArousalValue>(a_vm, "SetStaticArousalValue");
+        RegisterNative<SetStaticAuxillaryFloat>(a_vm, "SetStaticAuxillaryFloat");
+        RegisterNative<SetStaticAuxillaryInt>(a_vm, "SetStaticAuxillaryInt");
+        RegisterNative<ModStaticArousalValue>(a_vm, "ModStaticArousalValue");
+        RegisterNative<GetArousal>(a_vm, "GetArousal");
+        RegisterNative<GetArousalBatch>(a_vm, "GetArousalBatch");
+        RegisterNative<GetAllStaticEffectValues>(a_vm, "GetAllStaticEffectValues");
+        RegisterNative<GetDynamicEffectNames>(a_vm, "GetDynamicEffectNames");
+        RegisterNative<GetDynamicEffectValues>(a_vm, "GetDynamicEffectValues");
+        RegisterNative<UpdateSingleActorArousal>(a_vm, "UpdateSingleActorArousal");
+        RegisterNative<UpdateActorsArousal>(a_vm, "UpdateActorsArousal");
+        RegisterNative<UpdateAllActorsArousal>(a_vm, "UpdateAllActorsArousal");
+        RegisterNative<IsLazyUpdate>(a_vm, "IsLazyUpdate");
+        RegisterNative<SetLazyUpdate>(a_vm, "SetLazyUpdate");
+        RegisterNative<GetUpdateThreadCount>(a_vm, "GetUpdateThreadCount");
+        RegisterNative<SetUpdateThreadCount>(a_vm, "SetUpdateThreadCount");
+        RegisterNative<StartUpdateScheduler>(a_vm, "StartUpdateScheduler");
+        RegisterNative<StopUpdateScheduler>(a_vm, "StopUpdateScheduler");
+        RegisterNative<IsUpdateSchedulerRunning>(a_vm, "IsUpdateSchedulerRunning");
+        RegisterNative<GetUpdateSchedulerStats>(a_vm, "GetUpdateSchedulerStats");
+        RegisterNative<GetNativeStats>(a_vm, "GetNativeStats");
+        RegisterNative<DumpNativeStats>(a_vm, "DumpNativeStats");
+        RegisterNative<StartNativeTrace>(a_vm, "StartNativeTrace");
+        RegisterNative<StopNativeTrace>(a_vm, "StopNativeTrace");
+
+        RegisterNative<GroupEffects>(a_vm, "GroupEffects");
+        RegisterNative<RemoveEffectGroup>(a_vm, "RemoveEffectGroup");
+
+        RegisterNative<CleanUpActors>(a_vm, "CleanUpActors");
+        RegisterNative<GetMostArousedActors>(a_vm, "GetMostArousedActors");
+        RegisterNative<GetActorsInArousalRange>(a_vm, "GetActorsInArousalRange");
+        RegisterNative<CountActorsAboveArousal>(a_vm, "CountActorsAboveArousal");
+
+        RegisterNative<TryLock>(a_vm, "TryLock", true);
+        RegisterNative<Unlock>(a_vm, "Unlock", true);
+        RegisterNative<DuplicateActorArray>(a_vm, "DuplicateActorArray", true);
 
         return true;
     }
 
+    // A new game or a save without a SLAM record reverts without calling Serialization_Load
+    void OnMessage(SKSE::MessagingInterface::Message* message)
+    {
+        if (message->type == SKSE::MessagingInterface::kPostLoadGame || message->type == SKSE::MessagingInterface::kNewGame)
+            UpdateScheduler::GetSingleton().Resume();
+    }
+
     void RegisterSerialization()
     {
         auto serialization = SKSE::GetSerializationInterface();
@@ -481,5 +576,7 @@ namespace slaModules
         serialization->SetRevertCallback(Serialization_Revert);
         serialization->SetSaveCallback(Serialization_Save);
         serialization->SetLoadCallback(Serialization_Load);
+
+        SKSE::GetMessagingInterface()->RegisterListener(OnMessage);
     }
 }
\ No newline at end of file
@@ -1,53 +1,158 @@
 #pragma once
 
-void WriteString(SKSE::SerializationInterface* intfc, std::string const& string)
+// Builds a whole record in memory, so the co-save sees a single write per record
+class RecordWriter
 {
-    uint32_t length = static_cast<uint32_t>(string.length());
-    intfc->WriteRecordData(&length, sizeof(length));
-    intfc->WriteRecordData(string.c_str(), length);
-}
+public:
+    void Reserve(size_t size) { buffer.reserve(size); }
+    size_t Size() const { return buffer.size(); }
+    const char* Data() const { return buffer.data(); }
+    // Keeps the capacity, a writer reused for the next record of similar size does not reallocate
+    void Clear() { buffer.clear(); }
 
-template<typename Ty> void WriteContainerData(SKSE::SerializationInterface* intfc, Ty const& container)
-{
-    uint32_t size = static_cast<uint32_t>(container.size());
-    intfc->WriteRecordData(&size, sizeof(size));
-    for (auto const& kvp : container)
-        intfc->WriteRecordData(&kvp, sizeof(kvp));
-}
+    template <typename Ty>
+    void Write(Ty const& data)
+    {
+        static_assert(std::is_trivially_copyable_v<Ty>);
+        Append(&data, sizeof(data));
+    }
 
-template<typename Ty> Ty ReadDataHelper(SKSE::SerializationInterface* intfc, uint32_t& length)
-{
-    uint32_t size = sizeof(Ty);
-    if (size > length)
-        throw std::length_error("savegame data ended unexpected");
-    length -= size;
-    Ty result;
-    intfc->ReadRecordData(&result, size);
-    return result;
-}
-
-std::string ReadString(SKSE::SerializationInterface* intfc, uint32_t& length)
-{
-    uint32_t strlength = ReadDataHelper<uint32_t>(intfc, length);
-    if (strlength > length)
-        throw std::length_error("savegame data ended unexpected");
-    length -= strlength;
-    char* buf = new char[strlength + 1];
-    intfc->ReadRecordData(buf, strlength);
-    buf[strlength] = '\0';
-    std::string result(buf);
-    delete[] buf;
-    return result;
-}
-
-template <typename T>
-bool WriteData(SKSE::SerializationInterface* intfc, const T* data)
-{
-    return intfc->WriteRecordData(data, sizeof(T));
-}
+    void WriteBytes(const void* data, size_t size)
+    {
+        Append(data, size);
+    }
+
+    void WriteString(std::string_view string)
+    {
+        Write(static_cast<uint32_t>(string.length()));
+        Append(string.data(), string.length());
+    }
+
+    // LEB128, seven bits per byte starting with the lowest
+    void WriteVarint(uint32_t value)
+    {
+        uint8_t bytes[5];
+        size_t size = 0;
+        while (value >= 0x80)
+        {
+            bytes[size++] = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        bytes[size++] = static_cast<uint8_t>(value);
+        Append(bytes, size);
+    }
+
+    // Zigzag encoded, so small negative values stay short
+    void WriteSignedVarint(int32_t value)
+    {
+        WriteVarint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+    }
+
+    void WriteVarintString(std::string_view string)
+    {
+        WriteVarint(static_cast<uint32_t>(string.length()));
+        Append(string.data(), string.length());
+    }
+
+    template <typename Ty>
+    void WriteContainer(Ty const& container)
+    {
+        Write(static_cast<uint32_t>(container.size()));
+        for (auto const& kvp : container)
+            Write(kvp);
+    }
+
+    // Intfc is SKSE::SerializationInterface or a stand-in with the same record functions
+    template <typename Intfc>
+    bool Commit(Intfc* intfc) const
+    {
+        return intfc->WriteRecordData(buffer.data(), static_cast<uint32_t>(buffer.size()));
+    }
+
+private:
+    void Append(const void* data, size_t size)
+    {
+        const size_t offset = buffer.size();
+        buffer.resize(offset + size);
+        std::memcpy(buffer.data() + offset, data, size);
+    }
 
-template <typename T>
-bool ReadData(SKSE::SerializationInterface* intfc, T* data)
+    std::vector<char> buffer;
+};
+
+// Reads a whole record with one call and parses it in place. Strings are views into the buffer
+// and stay valid until the next Load.
+class RecordReader
 {
-    return intfc->ReadRecordData(data, sizeof(T)) > 0;
-}
\ No newline at end of file
+public:
+    template <typename Intfc>
+    void Load(Intfc* intfc, uint32_t length)
+    {
+        buffer.resize(length);
+        if (intfc->ReadRecordData(buffer.data(), length) != length)
+            throw std::length_error("savegame data ended unexpected");
+        cursor = 0;
+    }
+
+    // Takes over data that was read some other way, e.g. a whole file
+    void Load(std::vector<char> data)
+    {
+        buffer = std::move(data);
+        cursor = 0;
+    }
+
+    size_t Remaining() const { return buffer.size() - cursor; }
+
+    template <typename Ty>
+    Ty Read()
+    {
+        static_assert(std::is_trivially_copyable_v<Ty>);
+        Ty result;
+        std::memcpy(&result, Consume(sizeof(Ty)), sizeof(Ty));
+        return result;
+    }
+
+    std::string_view ReadString()
+    {
+        const uint32_t length = Read<uint32_t>();
+        return { Consume(length), length };
+    }
+
+    uint32_t ReadVarint()
+    {
+        uint32_t result = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7)
+        {
+            const uint8_t byte = Read<uint8_t>();
+            result |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return result;
+        }
+        throw std::out_of_range("Invalid varint in savegame data");
+    }
+
+    int32_t ReadSignedVarint()
+    {
+        const uint32_t value = ReadVarint();
+        return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+    }
+
+    std::string_view ReadVarintString()
+    {
+        const uint32_t length = ReadVarint();
+        return { Consume(length), length };
+    }
+
+private:
+    const char* Consume(size_t size)
+    {
+        if (size > Remaining())
+            throw std::length_error("savegame data ended unexpected");
+        const char* data = buffer.data() + cursor;
+        cursor += size;
+        return data;
+    }
+
+    std::vector<char> buffer;
+    size_t cursor = 0;
+};
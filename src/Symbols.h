@@ -0,0 +1,196 @@
+#pragma once
+
+namespace slaModules
+{
+    // Interned names shared by all actors. Ids are dense and stay valid until the table is cleared on revert.
+    // Natives on different shards intern concurrently, lookups share the lock and only new names take it exclusively.
+    class SymbolTable
+    {
+    public:
+        static constexpr uint32_t kInvalidSymbol = std::numeric_limits<uint32_t>::max();
+
+        uint32_t Intern(std::string_view name)
+        {
+            const uint32_t found = Find(name);
+            if (found != kInvalidSymbol)
+                return found;
+
+            std::unique_lock<std::shared_mutex> guard(lock);
+            auto itr = ids.find(name);
+            if (itr != ids.end())
+                return itr->second;
+            const auto id = static_cast<uint32_t>(names.size());
+            names.emplace_back(name);
+            ids.emplace(names.back(), id);
+            return id;
+        }
+
+        // Does not allocate, returns kInvalidSymbol for names that were never interned
+        uint32_t Find(std::string_view name) const
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            auto itr = ids.find(name);
+            return itr != ids.end() ? itr->second : kInvalidSymbol;
+        }
+
+        // The string stays in place until Clear
+        std::string const& Name(uint32_t id) const
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            return names[id];
+        }
+
+        uint32_t Size() const
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            return static_cast<uint32_t>(names.size());
+        }
+
+        // Nothing may use the table meanwhile, only called on revert
+        void Clear()
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            ids.clear();
+            names.clear();
+        }
+
+    private:
+        mutable std::shared_mutex lock;
+        // deque keeps the strings in place, the views in ids point into them
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, uint32_t> ids;
+    };
+
+    SymbolTable symbols;
+
+    // Names of the registered static effects, indexed by effect id. Unregistered ids keep their
+    // index in the actors' tables and go onto a free list to be handed out again.
+    // Every update reads the size, so it is kept in an atomic and does not need the lock.
+    class StaticEffectRegistry
+    {
+    public:
+        static constexpr uint32_t kInvalidId = std::numeric_limits<uint32_t>::max();
+
+        // Registry size including free ids, valid effect indices are below it
+        uint32_t Size() const { return size.load(std::memory_order_acquire); }
+
+        uint32_t Find(std::string_view name) const
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            return FindLocked(name);
+        }
+
+        // Indexed by id, empty for free ids
+        std::vector<std::string> GetNames() const
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            return { names.begin(), names.end() };
+        }
+
+        uint32_t Register(std::string_view name)
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            uint32_t id = FindLocked(name);
+            if (id != kInvalidId)
+                return id;
+
+            if (freeIds.empty())
+            {
+                id = static_cast<uint32_t>(names.size());
+                names.emplace_back(name);
+                size.store(id + 1, std::memory_order_release);
+            }
+            else
+            {
+                id = freeIds.back();
+                freeIds.pop_back();
+                names[id] = name;
+            }
+            ids.emplace(names[id], id);
+            return id;
+        }
+
+        uint32_t Unregister(std::string_view name)
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            auto itr = ids.find(name);
+            if (itr == ids.end())
+                return kInvalidId;
+            const uint32_t id = itr->second;
+            ids.erase(itr);
+            names[id].clear();
+            freeIds.push_back(id);
+            return id;
+        }
+
+        void Clear()
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            ClearLocked();
+        }
+
+        // Loading: Reset to the stored size, Assign every stored name, then FinishLoad.
+        // Empty names and the "UnusedN" placeholders of older saves mark free ids.
+
+        void Reset(uint32_t count)
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            ClearLocked();
+            names.resize(count);
+            size.store(count, std::memory_order_release);
+        }
+
+        void Assign(uint32_t id, std::string_view name)
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            if (id >= names.size())
+                throw std::out_of_range("Invalid static effect id");
+            if (name.empty() || IsPlaceholder(name) || !names[id].empty() || ids.count(name))
+                return;
+            names[id] = name;
+            ids.emplace(names[id], id);
+        }
+
+        void FinishLoad()
+        {
+            std::unique_lock<std::shared_mutex> guard(lock);
+            for (auto id = static_cast<uint32_t>(names.size()); id-- > 0;)
+            {
+                if (names[id].empty())
+                    freeIds.push_back(id);
+            }
+        }
+
+    private:
+        uint32_t FindLocked(std::string_view name) const
+        {
+            auto itr = ids.find(name);
+            return itr != ids.end() ? itr->second : kInvalidId;
+        }
+
+        void ClearLocked()
+        {
+            ids.clear();
+            names.clear();
+            freeIds.clear();
+            size.store(0, std::memory_order_release);
+        }
+
+        static bool IsPlaceholder(std::string_view name)
+        {
+            constexpr std::string_view prefix = "Unused";
+            if (name.size() <= prefix.size() || name.substr(0, prefix.size()) != prefix)
+                return false;
+            return std::all_of(name.begin() + prefix.size(), name.end(), [](char c) { return c >= '0' && c <= '9'; });
+        }
+
+        mutable std::shared_mutex lock;
+        std::atomic<uint32_t> size{ 0 };
+        // deque keeps the strings in place, the views in ids point into them
+        std::deque<std::string> names;
+        std::vector<uint32_t> freeIds;
+        std::unordered_map<std::string_view, uint32_t> ids;
+    };
+
+    StaticEffectRegistry staticEffectRegistry;
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "MemorySerialization.h"
+#include "Serialization.h"
+
+// Set to 0 to compile the natives without the trace recorder
+#ifndef SLAM_NATIVE_TRACE
+#define SLAM_NATIVE_TRACE 1
+#endif
+
+namespace slaModules
+{
+    // A trace starts with kTraceMagic, kTraceVersion, the jitter seed and the varint count and
+    // names of all natives, their position is the native id. Events follow until the end of the
+    // file, each starts with a TraceEvent byte:
+    //  Call:     varint native id, float game time, the arguments, the return value
+    //  Snapshot: lazy update byte, scheduler byte, then the engine state as saved records, see
+    //            MemorySerializationInterface::Serialize. The scheduler byte is 1 if it runs or resumes
+    //            after the load, its slices follow as events.
+    //  Revert:   nothing
+    //  Slice:    float game time, varint count and formIds of the actors the scheduler updated, varint
+    //            mask of the shards whose dormant actors it moved on to the game time
+    // Actors are written as varint formIds, 0 for none. Integers are zigzag varints, floats raw,
+    // bools one byte, strings varint length and bytes, arrays varint count and elements.
+    const uint32_t kTraceMagic = 'SLTR';
+    const uint32_t kTraceVersion = 2;
+
+    enum class TraceEvent : uint8_t
+    {
+        Call,
+        Snapshot,
+        Revert,
+        Slice
+    };
+
+    // Collects events from any thread and writes them to the trace file in large blocks
+    class TraceRecorder
+    {
+    public:
+        static constexpr size_t kFlushSize = 1 << 20;
+
+        // Natives are added once at registration, before anything is recorded
+        uint32_t AddNative(const char* name)
+        {
+            natives.push_back(name);
+            return static_cast<uint32_t>(natives.size() - 1);
+        }
+
+        bool IsRecording() const { return recording.load(std::memory_order_relaxed); }
+
+        // Keeps the recorded order the order things happened in. Recorded calls hold this shared from
+        // before they change anything until they are appended. Snapshots and scheduler slices hold it
+        // exclusively, so only calls on different VM threads can still race each other.
+        std::shared_lock<std::shared_mutex> LockCall() { return std::shared_lock<std::shared_mutex>(order); }
+        std::unique_lock<std::shared_mutex> LockExclusive() { return std::unique_lock<std::shared_mutex>(order); }
+
+        // snapshot is the engine state the trace starts from
+        bool Start(std::string const& path, uint64_t seed, bool lazyUpdate, bool scheduler, MemorySerializationInterface const& snapshot)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (recording)
+                return false;
+            file.open(path, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return false;
+
+            buffer.Clear();
+            buffer.Write(kTraceMagic);
+            buffer.Write(kTraceVersion);
+            buffer.Write(seed);
+            buffer.WriteVarint(static_cast<uint32_t>(natives.size()));
+            for (const char* name : natives)
+                buffer.WriteVarintString(name);
+            WriteSnapshot(lazyUpdate, scheduler, snapshot);
+            calls = 0;
+            recording = true;
+            return true;
+        }
+
+        // Returns the number of calls recorded
+        uint64_t Stop()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!recording)
+                return 0;
+            recording = false;
+            Flush();
+            file.close();
+            return calls;
+        }
+
+        // event holds one complete Call event. Calls finishing after Stop are dropped.
+        void AppendCall(RecordWriter const& event)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!recording)
+                return;
+            buffer.WriteBytes(event.Data(), event.Size());
+            ++calls;
+            if (buffer.Size() >= kFlushSize)
+                Flush();
+        }
+
+        // event holds one complete Slice event
+        void AppendSlice(RecordWriter const& event)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!recording)
+                return;
+            buffer.WriteBytes(event.Data(), event.Size());
+            if (buffer.Size() >= kFlushSize)
+                Flush();
+        }
+
+        void AppendSnapshot(bool lazyUpdate, bool scheduler, MemorySerializationInterface const& snapshot)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (recording)
+                WriteSnapshot(lazyUpdate, scheduler, snapshot);
+        }
+
+        void AppendRevert()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (recording)
+                buffer.Write(TraceEvent::Revert);
+        }
+
+    private:
+        void WriteSnapshot(bool lazyUpdate, bool scheduler, MemorySerializationInterface const& snapshot)
+        {
+            buffer.Write(TraceEvent::Snapshot);
+            buffer.Write<uint8_t>(lazyUpdate);
+            buffer.Write<uint8_t>(scheduler);
+            snapshot.Serialize(buffer);
+        }
+
+        void Flush()
+        {
+            file.write(buffer.Data(), static_cast<std::streamsize>(buffer.Size()));
+            buffer.Clear();
+        }
+
+        std::vector<const char*> natives;
+        std::atomic<bool> recording{ false };
+        std::shared_mutex order;
+        std::mutex lock;
+        std::ofstream file;
+        RecordWriter buffer;
+        uint64_t calls = 0;
+    };
+
+    TraceRecorder nativeTrace;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+namespace slaModules
+{
+    // Persistent worker threads running chunked loops. Each participant starts with an even
+    // share of the chunks and steals the upper half of another share once its own runs dry.
+    class UpdatePool
+    {
+    public:
+        using ChunkFunc = std::function<void(size_t, size_t)>;
+
+        static UpdatePool& GetSingleton()
+        {
+            // Intentionally leaked, joining threads from static destructors deadlocks under the loader lock
+            static UpdatePool* singleton = new UpdatePool();
+            return *singleton;
+        }
+
+        uint32_t GetThreadCount() const { return threadCount; }
+
+        void SetThreadCount(uint32_t count)
+        {
+            std::lock_guard<std::mutex> runGuard(runLock);
+            StopWorkers();
+            threadCount = std::max(count, 1u);
+        }
+
+        // Calls func(begin, end) for consecutive ranges of at most chunkSize indices covering [0, count)
+        // and returns once all of them are done. func must not throw.
+        void ParallelFor(size_t count, size_t chunkSize, ChunkFunc const& func)
+        {
+            if (!count)
+                return;
+            chunkSize = std::max<size_t>(chunkSize, 1);
+            const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+            std::lock_guard<std::mutex> runGuard(runLock);
+            if (threadCount == 1 || chunkCount == 1)
+            {
+                func(0, count);
+                return;
+            }
+
+            StartWorkers();
+            for (uint32_t i = 0; i < threadCount; ++i)
+            {
+                const uint64_t first = chunkCount * i / threadCount;
+                const uint64_t last = chunkCount * (i + 1) / threadCount;
+                queues[i].range.store(Pack(first, last));
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(jobLock);
+                job = &func;
+                jobCount = count;
+                jobChunkSize = chunkSize;
+                pending = threadCount - 1;
+                ++jobGeneration;
+            }
+            jobStart.notify_all();
+
+            RunParticipant(0);
+
+            std::unique_lock<std::mutex> guard(jobLock);
+            jobDone.wait(guard, [this] { return pending == 0; });
+            job = nullptr;
+        }
+
+    private:
+        struct alignas(64) WorkQueue
+        {
+            std::atomic<uint64_t> range{ 0 };
+        };
+
+        UpdatePool() : threadCount(std::max(std::thread::hardware_concurrency(), 1u)) {}
+
+        static uint64_t Pack(uint64_t first, uint64_t last) { return (last << 32) | first; }
+        static uint32_t First(uint64_t range) { return static_cast<uint32_t>(range); }
+        static uint32_t Last(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+
+        void StartWorkers()
+        {
+            if (!workers.empty())
+                return;
+            queues = std::make_unique<WorkQueue[]>(threadCount);
+            // Workers started after a resize must not take the generation of an earlier job for a new one
+            uint64_t generation;
+            {
+                std::lock_guard<std::mutex> guard(jobLock);
+                generation = jobGeneration;
+            }
+            for (uint32_t i = 1; i < threadCount; ++i)
+                workers.emplace_back(&UpdatePool::WorkerMain, this, i, generation);
+        }
+
+        void StopWorkers()
+        {
+            {
+                std::lock_guard<std::mutex> guard(jobLock);
+                stopping = true;
+            }
+            jobStart.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+            workers.clear();
+            stopping = false;
+        }
+
+        void WorkerMain(uint32_t index, uint64_t seenGeneration)
+        {
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> guard(jobLock);
+                    jobStart.wait(guard, [&] { return stopping || jobGeneration != seenGeneration; });
+                    if (stopping)
+                        return;
+                    seenGeneration = jobGeneration;
+                }
+
+                RunParticipant(index);
+
+                std::lock_guard<std::mutex> guard(jobLock);
+                if (--pending == 0)
+                    jobDone.notify_one();
+            }
+        }
+
+        void RunParticipant(uint32_t index)
+        {
+            uint32_t chunk;
+            while (PopChunk(index, chunk) || StealChunks(index, chunk))
+            {
+                const size_t begin = chunk * jobChunkSize;
+                (*job)(begin, std::min(begin + jobChunkSize, jobCount));
+            }
+        }
+
+        bool PopChunk(uint32_t index, uint32_t& chunk)
+        {
+            auto& range = queues[index].range;
+            uint64_t current = range.load();
+            while (First(current) < Last(current))
+            {
+                if (range.compare_exchange_weak(current, Pack(First(current) + 1ull, Last(current))))
+                {
+                    chunk = First(current);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool StealChunks(uint32_t index, uint32_t& chunk)
+        {
+            for (uint32_t offset = 1; offset < threadCount; ++offset)
+            {
+                auto& victim = queues[(index + offset) % threadCount].range;
+                uint64_t current = victim.load();
+                while (First(current) < Last(current))
+                {
+                    const uint32_t available = Last(current) - First(current);
+                    const uint32_t split = Last(current) - (available + 1) / 2;
+                    if (victim.compare_exchange_weak(current, Pack(First(current), split)))
+                    {
+                        chunk = split;
+                        queues[index].range.store(Pack(split + 1ull, Last(current)));
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        UpdatePool(const UpdatePool&) = delete;
+        UpdatePool& operator=(const UpdatePool&) = delete;
+
+        uint32_t threadCount;
+        std::vector<std::thread> workers;
+        std::unique_ptr<WorkQueue[]> queues;
+
+        std::mutex runLock;
+        std::mutex jobLock;
+        std::condition_variable jobStart;
+        std::condition_variable jobDone;
+        ChunkFunc const* job = nullptr;
+        size_t jobCount = 0;
+        size_t jobChunkSize = 0;
+        uint32_t pending = 0;
+        uint64_t jobGeneration = 0;
+        bool stopping = false;
+    };
+}
\ No newline at end of file
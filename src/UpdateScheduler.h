@@ -0,0 +1,372 @@
+#pragma once
+
+#include "Engine.h"
+#include "Trace.h"
+
+namespace slaModules
+{
+    // Cost and lag of the slices run so far. Only the thread running the slices writes them.
+    struct SliceStats
+    {
+        void Reset()
+        {
+            slices = 0;
+            updates = 0;
+            overruns = 0;
+            totalNs = 0;
+            maxNs = 0;
+            rounds = 0;
+            totalLag = 0.0;
+            maxLag = 0.f;
+            lastRoundDays = 0.f;
+        }
+
+        std::string Format() const
+        {
+            const uint64_t count = slices.load(std::memory_order_relaxed);
+            const uint64_t updated = updates.load(std::memory_order_relaxed);
+            char line[256];
+            std::snprintf(line, sizeof(line), "%llu slices, avg %.1fus, max %.1fus, %llu over budget, %llu actors updated, lag avg %.2fh max %.2fh, %llu rounds, last %.2fh",
+                static_cast<unsigned long long>(count), count ? totalNs.load(std::memory_order_relaxed) / 1000.0 / count : 0.0,
+                maxNs.load(std::memory_order_relaxed) / 1000.0, static_cast<unsigned long long>(overruns.load(std::memory_order_relaxed)),
+                static_cast<unsigned long long>(updated), updated ? totalLag.load(std::memory_order_relaxed) * 24.0 / updated : 0.0,
+                maxLag.load(std::memory_order_relaxed) * 24.0, static_cast<unsigned long long>(rounds.load(std::memory_order_relaxed)),
+                lastRoundDays.load(std::memory_order_relaxed) * 24.0);
+            return line;
+        }
+
+        std::atomic<uint64_t> slices{ 0 };
+        std::atomic<uint64_t> updates{ 0 };
+        // Slices that ran over their budget by more than a tenth. A slice that uses up its budget always
+        // overshoots a little, the clock is only checked every few actors.
+        std::atomic<uint64_t> overruns{ 0 };
+        std::atomic<uint64_t> totalNs{ 0 };
+        std::atomic<uint64_t> maxNs{ 0 };
+        // Times the round robin went through every actor
+        std::atomic<uint64_t> rounds{ 0 };
+        // Game days between the previous update of an actor and the one a slice did
+        std::atomic<double> totalLag{ 0.0 };
+        std::atomic<float> maxLag{ 0.f };
+        // Game days the last complete round took
+        std::atomic<float> lastRoundDays{ 0.f };
+    };
+
+    // Updates actors in slices of bounded duration on its own thread, instead of scripts looping
+    // over GetActorList. Each slice first updates the actors natives used since the last slice, then
+    // continues the round robin over the awake actors where the previous slice stopped. In lazy mode
+    // only actors past their expiry are updated.
+    //
+    // The thread never asks the host for the game time, the host hands it in through SetGameTime from
+    // its own threads. Slices wait until a time is known.
+    class UpdateScheduler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // now() is not free, the deadline is checked once per this many actors
+        static constexpr uint32_t kClockCheckInterval = 8;
+
+        // Provided by the host, asks it to call SetGameTime soon. Called before every slice.
+        static inline void (*requestGameTime)() = nullptr;
+
+        static UpdateScheduler& GetSingleton()
+        {
+            // Intentionally leaked like the UpdatePool, its thread must not be joined from static destructors
+            static UpdateScheduler* singleton = new UpdateScheduler();
+            return *singleton;
+        }
+
+        // Runs a slice of at most budget every interval, restarting with the new settings if already running
+        void Start(std::chrono::microseconds budget, std::chrono::milliseconds interval)
+        {
+            Stop();
+            std::lock_guard<std::mutex> guard(lock);
+            sliceBudget = budget;
+            sliceInterval = interval;
+            stopping = false;
+            paused = false;
+            recentActors.SetEnabled(true);
+            thread = std::thread([this] { Run(); });
+        }
+
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                // Stopping a paused scheduler keeps it from resuming after the load
+                paused = false;
+                if (!thread.joinable())
+                    return;
+                stopping = true;
+            }
+            wake.notify_all();
+            thread.join();
+            recentActors.SetEnabled(false);
+        }
+
+        // Stops the thread for a revert and load, which must not race the slices: the game time handed
+        // in is still the old save's and the cleared data would get published again. Resume starts it
+        // with the same settings.
+        void Pause()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!thread.joinable())
+                    return;
+            }
+            Stop();
+            std::lock_guard<std::mutex> guard(lock);
+            paused = true;
+            // The next round starts over in the loaded game, once the host provides its time
+            shardCursor = 0;
+            slotCursor = 0;
+            roundStart = -1.f;
+            gameTime.store(0.f, std::memory_order_relaxed);
+        }
+
+        void SetGameTime(float time)
+        {
+            gameTime.store(time, std::memory_order_relaxed);
+        }
+
+        void Resume()
+        {
+            std::chrono::microseconds budget;
+            std::chrono::milliseconds interval;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!paused)
+                    return;
+                budget = sliceBudget;
+                interval = sliceInterval;
+            }
+            Start(budget, interval);
+        }
+
+        bool IsRunning()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return thread.joinable();
+        }
+
+        // Paused for a revert and load, it runs again after
+        bool IsPaused()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return paused;
+        }
+
+        SliceStats& GetStats() { return stats; }
+
+        // Updates actors due at time until budget is spent and returns how many. Only one thread
+        // may run slices at a time, the scheduler thread while it runs.
+        uint32_t RunSlice(float time, Clock::duration budget)
+        {
+            // Which actors a slice gets to depends on the clock, a trace records them instead. Taken
+            // before checking, so a trace starting meanwhile snapshots the state after this slice.
+            // Recorded calls wait for the slice, without a trace nothing else takes the lock.
+            auto order = nativeTrace.LockExclusive();
+            tracing = nativeTrace.IsRecording();
+            traced.clear();
+            dormantShards = 0;
+
+            const auto start = Clock::now();
+            const auto deadline = start + budget;
+            const bool lazy = lazyUpdate;
+            uint32_t updated = 0;
+            uint32_t visited = 0;
+            auto outOfTime = [&] { return ++visited % kClockCheckInterval == 0 && Clock::now() >= deadline; };
+            if (roundStart < 0.f)
+                roundStart = time;
+
+            // Actors that were just used first, grouped by shard so each lock is taken once
+            recent.clear();
+            recentActors.Drain(recent);
+            std::sort(recent.begin(), recent.end(), [](uint32_t a, uint32_t b) {
+                const uint32_t shardA = ShardedActorStore::ShardIndex(a);
+                const uint32_t shardB = ShardedActorStore::ShardIndex(b);
+                return shardA != shardB ? shardA < shardB : a < b;
+            });
+            recent.erase(std::unique(recent.begin(), recent.end()), recent.end());
+            bool expired = false;
+            for (size_t i = 0; i < recent.size() && !expired;)
+            {
+                auto& shard = arousalData.ShardOf(recent[i]);
+                std::lock_guard<std::mutex> guard(shard.lock);
+                for (; i < recent.size() && &arousalData.ShardOf(recent[i]) == &shard; ++i)
+                {
+                    if (outOfTime())
+                    {
+                        expired = true;
+                        break;
+                    }
+                    // Dormant actors were only read, there is nothing to update
+                    const ActorHandle handle = shard.store.FindHandle(recent[i]);
+                    if (handle.slot == ActorHandle::kInvalidSlot || shard.store.IsDormant(handle.slot))
+                        continue;
+                    if (IsDue(*shard.store.Resolve(handle), time, lazy))
+                    {
+                        Update(shard.store, handle.slot, time, lazy);
+                        ++updated;
+                    }
+                }
+            }
+
+            // The round robin resumes where the last slice ran out of time
+            for (uint32_t shards = 0; shards < ShardedActorStore::kShardCount && !expired; ++shards)
+            {
+                auto& shard = arousalData.ShardAt(shardCursor);
+                std::lock_guard<std::mutex> guard(shard.lock);
+                ActorStore& store = shard.store;
+                for (; (slotCursor = store.NextAwake(slotCursor)) != ActorHandle::kInvalidSlot; ++slotCursor)
+                {
+                    if (outOfTime())
+                    {
+                        expired = true;
+                        break;
+                    }
+                    uint32_t formId;
+                    if (IsDue(*store.AtSlot(slotCursor, formId), time, lazy))
+                    {
+                        Update(store, slotCursor, time, lazy);
+                        ++updated;
+                    }
+                }
+                if (!lazy)
+                {
+                    store.SetDormantTime(time);
+                    dormantShards |= 1u << shardCursor;
+                }
+                if (expired)
+                    break;
+
+                slotCursor = 0;
+                if (++shardCursor == ShardedActorStore::kShardCount)
+                {
+                    shardCursor = 0;
+                    stats.rounds.fetch_add(1, std::memory_order_relaxed);
+                    stats.lastRoundDays.store(std::max(time - roundStart, 0.f), std::memory_order_relaxed);
+                    roundStart = time;
+                    // A round per slice is enough, the actors were just visited
+                    break;
+                }
+            }
+
+            const auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            stats.slices.fetch_add(1, std::memory_order_relaxed);
+            stats.updates.fetch_add(updated, std::memory_order_relaxed);
+            stats.totalNs.fetch_add(ns, std::memory_order_relaxed);
+            if (ns > static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(budget).count()) * 11 / 10)
+                stats.overruns.fetch_add(1, std::memory_order_relaxed);
+            if (ns > stats.maxNs.load(std::memory_order_relaxed))
+                stats.maxNs.store(ns, std::memory_order_relaxed);
+
+            if (tracing)
+            {
+                sliceEvent.Clear();
+                sliceEvent.Write(TraceEvent::Slice);
+                sliceEvent.Write(time);
+                sliceEvent.WriteVarint(static_cast<uint32_t>(traced.size()));
+                for (uint32_t formId : traced)
+                    sliceEvent.WriteVarint(formId);
+                sliceEvent.WriteVarint(dormantShards);
+                nativeTrace.AppendSlice(sliceEvent);
+            }
+            return updated;
+        }
+
+        // Repeats a recorded slice, see TraceEvent::Slice. Actors are updated in the order the slice
+        // did, and only dormant actors see the dormant time, so moving it on last changes nothing.
+        void ReplaySlice(float time, std::vector<uint32_t> const& formIds, uint32_t shards)
+        {
+            const bool lazy = lazyUpdate;
+            for (uint32_t formId : formIds)
+            {
+                auto& shard = arousalData.ShardOf(formId);
+                std::lock_guard<std::mutex> guard(shard.lock);
+                const ActorHandle handle = shard.store.FindHandle(formId);
+                if (handle.slot != ActorHandle::kInvalidSlot && UpdateLockedActor(shard.store, handle.slot, time) && lazy)
+                    shard.store.ScheduleSlot(handle.slot);
+            }
+            for (uint32_t i = 0; i < ShardedActorStore::kShardCount; ++i)
+            {
+                if (!((shards >> i) & 1))
+                    continue;
+                auto& shard = arousalData.ShardAt(i);
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.store.SetDormantTime(time);
+            }
+        }
+
+    private:
+        UpdateScheduler() = default;
+
+        static bool IsDue(ArousalData const& data, float time, bool lazy)
+        {
+            const float lastUpdate = data.GetLastUpdate();
+            if (!lastUpdate)
+                return true;
+            // Also keeps paused games from costing anything
+            if (time <= lastUpdate)
+                return false;
+            return !lazy || data.NeedsUpdate(time);
+        }
+
+        void Update(ActorStore& store, uint32_t slot, float time, bool lazy)
+        {
+            uint32_t formId;
+            ArousalData const& data = *store.AtSlot(slot, formId);
+            if (const float lastUpdate = data.GetLastUpdate())
+            {
+                const float lag = time - lastUpdate;
+                stats.totalLag.store(stats.totalLag.load(std::memory_order_relaxed) + lag, std::memory_order_relaxed);
+                if (lag > stats.maxLag.load(std::memory_order_relaxed))
+                    stats.maxLag.store(lag, std::memory_order_relaxed);
+            }
+            if (tracing)
+                traced.push_back(formId);
+            if (UpdateLockedActor(store, slot, time) && lazy)
+                store.ScheduleSlot(slot);
+        }
+
+        void Run()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (!stopping)
+            {
+                const auto budget = sliceBudget;
+                guard.unlock();
+                if (requestGameTime)
+                    requestGameTime();
+                if (const float time = gameTime.load(std::memory_order_relaxed); time > 0.f)
+                    RunSlice(time, budget);
+                guard.lock();
+                wake.wait_for(guard, sliceInterval, [this] { return stopping; });
+            }
+        }
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::thread thread;
+        bool stopping = false;
+        bool paused = false;
+        std::chrono::microseconds sliceBudget{ 0 };
+        std::chrono::milliseconds sliceInterval{ 0 };
+        // Latest game time from the host, 0 while unknown
+        std::atomic<float> gameTime{ 0.f };
+
+        // Only touched by the thread running the slices
+        std::vector<uint32_t> recent;
+        uint32_t shardCursor = 0;
+        uint32_t slotCursor = 0;
+        // Game time the current round started at, negative before the first slice
+        float roundStart = -1.f;
+        // What the current slice did, kept while a trace records
+        static_assert(ShardedActorStore::kShardCount <= 32, "dormantShards has a bit per shard");
+        bool tracing = false;
+        std::vector<uint32_t> traced;
+        uint32_t dormantShards = 0;
+        RecordWriter sliceEvent;
+        SliceStats stats;
+    };
+}
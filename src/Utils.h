@@ -1,51 +1,35 @@
 #pragma once
 
-#define MAX_CIRCLE_ANGLE      512
-#define HALF_MAX_CIRCLE_ANGLE (MAX_CIRCLE_ANGLE/2)
-#define QUARTER_MAX_CIRCLE_ANGLE (MAX_CIRCLE_ANGLE/4)
-#define MASK_MAX_CIRCLE_ANGLE (MAX_CIRCLE_ANGLE - 1)
-#define PI 3.14159265358979323846f
-
-float fast_cossin_table[MAX_CIRCLE_ANGLE + 1]; // Declare table of fast cosinus and sinus
-
-float fastcos(float n)
+uint32_t CountTrailingZeros(uint64_t value)
 {
-    float f = n * HALF_MAX_CIRCLE_ANGLE / PI;
-    int i = static_cast<int>(f);
-    if (i < 0)
-    {
-        return fast_cossin_table[((-i) + QUARTER_MAX_CIRCLE_ANGLE) & MASK_MAX_CIRCLE_ANGLE];
-    }
-    else
-    {
-        return fast_cossin_table[(i + QUARTER_MAX_CIRCLE_ANGLE) & MASK_MAX_CIRCLE_ANGLE];
-    }
-
-    assert(0);
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, value);
+    return idx;
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
 }
 
-float fastsin(float n)
+// Number of bits needed to represent value, 0 for 0
+uint32_t BitWidth(uint64_t value)
 {
-    float f = n * HALF_MAX_CIRCLE_ANGLE / PI;
-    int i = static_cast<int>(f);
-    if (i < 0)
-    {
-        int idx = (-((-i) & MASK_MAX_CIRCLE_ANGLE)) + MAX_CIRCLE_ANGLE;
-        assert(idx >= 0 && idx <= MAX_CIRCLE_ANGLE);
-        return fast_cossin_table[idx];
-    }
-    else
-    {
-        int idx = i & MASK_MAX_CIRCLE_ANGLE;
-        assert(idx >= 0 && idx <= MAX_CIRCLE_ANGLE);
-        return fast_cossin_table[idx];
-    }
-
-    assert(0);
+    if (!value)
+        return 0;
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse64(&idx, value);
+    return idx + 1;
+#else
+    return 64 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
 }
 
-void BuildSinCosTable()
+// SplitMix64 finalizer, spreads every input bit over the whole result
+uint64_t Mix64(uint64_t value)
 {
-    for (long i = 0; i <= MAX_CIRCLE_ANGLE; i++)
-        fast_cossin_table[i] = (float)sin((double)i * PI / HALF_MAX_CIRCLE_ANGLE);
-}
\ No newline at end of file
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}